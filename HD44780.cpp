@@ -6,6 +6,7 @@
  */
 
 #include "HD44780.h"
+#include "hd44780_driver.h"
 
 delay_t delayMs = nullptr;
 
@@ -17,27 +18,168 @@ set_pin_t dataLine5Write = nullptr;
 set_pin_t dataLine6Write = nullptr;
 set_pin_t dataLine7Write = nullptr;
 
+/*
+ *  8 bit interface: D0..D3 wired too (per-pin callbacks or a bus callback
+ *  taking the whole byte), one enable pulse per byte
+ */
+set_pin_t dataLine0Write = nullptr;
+set_pin_t dataLine1Write = nullptr;
+set_pin_t dataLine2Write = nullptr;
+set_pin_t dataLine3Write = nullptr;
+
+static bool eightBitInterface = false;
+
+/*
+ *  Bus mode: a single callback drives RS, RW, EN and D4..D7 together.
+ *  The driver keeps the current level of the lines, since every call
+ *  rewrites all of them.
+ */
+set_bus_t busWrite = nullptr;
+
+static int busRS = 0;
+static int busRW = 0;
+static int busData = 0;
+
+/*
+ *  Busy flag: with a read callback for D7 the driver polls BF before each
+ *  transfer instead of sleeping 2 ms after every enable pulse.
+ *  setDataInput switches D4..D7 between input (1) and output (0) and
+ *  delayUs stretches the enable pulse; both are optional.
+ */
+get_pin_t dataLine7Read = nullptr;
+set_pin_t dataInputWrite = nullptr;
+delay_t delayUs = nullptr;
+
 int registeredCallbacks = 0;
 
 const int LOW = 0;
 const int HIGH = 1;
 
+/*
+ *  Level last written on each line by the callbacks (-1: unknown), so the
+ *  per-pin mode only calls the callbacks of the lines that change
+ */
+static int lineRS = -1;
+static int lineRW = -1;
+static int lineData[4] = {-1, -1, -1, -1};
+static int lineDataLow[4] = {-1, -1, -1, -1};
+
+static void forgetLines(void) {
+    lineRS = -1;
+    lineRW = -1;
+    for (int i = 0; i < 4; i++) {
+        lineData[i] = -1;
+        lineDataLow[i] = -1;
+    }
+}
+
+static void writeLine(set_pin_t write, int &line, int level) {
+    if (line != level) {
+        line = level;
+        write(level);
+    }
+}
+
+/*
+ *  Pin policy of the driver template over the registered callbacks: the
+ *  bus callback when present, else the per-pin ones
+ */
+struct CallbackPins {
+    static void lines(int rs, int rw, unsigned char value)
+    {
+        if (busWrite != nullptr) {
+            busRS = rs;
+            busRW = rw;
+            busData = eightBitInterface ? value : value & 0x0F;
+            busWrite(busRS, busRW, LOW, busData);
+            return;
+        }
+
+        writeLine(registerSelectWrite, lineRS, rs);
+        writeLine(readWriteWrite, lineRW, rw);
+        if (eightBitInterface) {
+            dataLow(value & 0x0F);
+            data(value >> 4);
+        } else {
+            data(value);
+        }
+    }
+
+    static void data(unsigned char nibble)
+    {
+        writeLine(dataLine4Write, lineData[0], nibble & 1);
+        writeLine(dataLine5Write, lineData[1], (nibble >> 1) & 1);
+        writeLine(dataLine6Write, lineData[2], (nibble >> 2) & 1);
+        writeLine(dataLine7Write, lineData[3], (nibble >> 3) & 1);
+    }
+
+    static void dataLow(unsigned char nibble)
+    {
+        writeLine(dataLine0Write, lineDataLow[0], nibble & 1);
+        writeLine(dataLine1Write, lineDataLow[1], (nibble >> 1) & 1);
+        writeLine(dataLine2Write, lineDataLow[2], (nibble >> 2) & 1);
+        writeLine(dataLine3Write, lineDataLow[3], (nibble >> 3) & 1);
+    }
+
+    static void readMode(int rw)
+    {
+        if (busWrite != nullptr) {
+            busRS = LOW;
+            busRW = rw;
+            busWrite(busRS, busRW, LOW, busData);
+            return;
+        }
+
+        writeLine(registerSelectWrite, lineRS, LOW);
+        writeLine(readWriteWrite, lineRW, rw);
+    }
+
+    static void enable(int level)
+    {
+        if (busWrite != nullptr) {
+            busWrite(busRS, busRW, level, busData);
+        } else {
+            enableWrite(level);
+        }
+    }
+
+    static bool eightBit() { return eightBitInterface; }
+    static bool busyFlag() { return dataLine7Read != nullptr; }
+
+    static void dataInput(bool input)
+    {
+        if (dataInputWrite != nullptr) {
+            dataInputWrite(input ? HIGH : LOW);
+        }
+    }
+
+    static int busy() { return dataLine7Read(); }
+    static void delayMs(int ms) { ::delayMs(ms); }
+
+    static void delayUs(int us)
+    {
+        if (::delayUs != nullptr) {
+            ::delayUs(us);
+        }
+    }
+};
+
+/* The C API drives one LCD_LINES x LCD_LINE_LENGHT panel through the callbacks */
+static HD44780Driver<CallbackPins, LcdGeometry<LCD_LINES, LCD_LINE_LENGHT> > lcd;
+
 void init_LCD(void) {
 /*****************************************************************************
  *
  * Description:
- *    Initializes the LCD display with basic settings (4bit mode)
+ *    Initializes the LCD display with basic settings (4bit mode, 8bit mode
+ *    when D0..D3 are registered)
  *
  ****************************************************************************/
-	putCommand_hf(0x30);			// sequence for initialization
-	putCommand_hf(0x30);    		// ----
-	putCommand_hf(0x20);    		// ----
-
-	putCommand(FOUR_BIT_TWO_LINE_5x8_CMD);	    // selecting 16 x 2 LCD in 4bit mode with 5x7 pixels
-    putCommand(DISP_ON_CUR_OFF_BLINK_OFF_CMD);	// display ON cursor OFF blinking OFF
-    putCommand(DISPLAY_CLEAR_CMD);          	// clear display
-    putCommand(ENTRY_MODE_INC_NO_SHIFT_CMD);    // cursor auto increment
-    putCommand(0x80);          			        // 1st line 1st location of LCD 0 offset 80h
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
+    }
+
+    lcd.init();
 }
 
 void clear_line(void) {
@@ -51,10 +193,16 @@ void clear_line(void) {
         return;
     }
 
-    dataLine4Write(LOW);
-    dataLine5Write(LOW);
-    dataLine6Write(LOW);
-    dataLine7Write(LOW);
+    if (busWrite != nullptr) {
+        busData = 0;
+        busWrite(busRS, busRW, LOW, busData);
+        return;
+    }
+
+    CallbackPins::data(0);
+    if (eightBitInterface) {
+        CallbackPins::dataLow(0);
+    }
 }
 
 void toggle(void) {
@@ -68,9 +216,9 @@ void toggle(void) {
         return;
     }
 
-    enableWrite(HIGH);
+    CallbackPins::enable(HIGH);
 	delayMs(2);
-    enableWrite(LOW);
+    CallbackPins::enable(LOW);
 }
 
 void sendUpperByte(char data_to_LCD) {
@@ -87,33 +235,13 @@ void sendUpperByte(char data_to_LCD) {
         return;
     }
 
-    if(data_to_LCD & 0x10)
-    {
-        dataLine4Write(HIGH);
-    } else {
-    	dataLine4Write(LOW);
-    }
-
-    if(data_to_LCD & 0x20)
-    {
-    	dataLine5Write(HIGH);
-    } else {
-    	dataLine5Write(LOW);
-    }
-
-    if(data_to_LCD & 0x40)
-    {
-    	dataLine6Write(HIGH);
-    } else {
-    	dataLine6Write(LOW);
+    if (busWrite != nullptr) {
+        busData = (data_to_LCD >> 4) & 0x0F;
+        busWrite(busRS, busRW, LOW, busData);
+        return;
     }
 
-    if(data_to_LCD & 0x80)
-    {
-    	dataLine7Write(HIGH);
-    } else {
-    	dataLine7Write(LOW);
-    }
+    CallbackPins::data((data_to_LCD >> 4) & 0x0F);
 }
 
 void sendLowerByte(char data_to_LCD) {
@@ -126,33 +254,17 @@ void sendLowerByte(char data_to_LCD) {
  *    [in] data_to_LCD - byte to be sent to the LCD
  *
  ****************************************************************************/
-    if(data_to_LCD & 0x01)
-    {
-        dataLine4Write(HIGH);
-    } else {
-    	dataLine4Write(LOW);
-    }
-
-    if(data_to_LCD & 0x02)
-    {
-    	dataLine5Write(HIGH);
-    } else {
-    	dataLine5Write(LOW);
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
     }
 
-    if(data_to_LCD & 0x04)
-    {
-    	dataLine6Write(HIGH);
-    } else {
-    	dataLine6Write(LOW);
+    if (busWrite != nullptr) {
+        busData = data_to_LCD & 0x0F;
+        busWrite(busRS, busRW, LOW, busData);
+        return;
     }
 
-    if(data_to_LCD & 0x08)
-    {
-    	dataLine7Write(HIGH);
-    } else {
-    	dataLine7Write(LOW);
-    }
+    CallbackPins::data(data_to_LCD & 0x0F);
 }
 
 void putCommand_hf(char data_to_LCD) {
@@ -169,12 +281,7 @@ void putCommand_hf(char data_to_LCD) {
         return;
     }
 
-    registerSelectWrite(LOW);	    // selecting register as command register
-    readWriteWrite(LOW);	        // selecting write mode
-    clear_line();              	    // clearing the 4 bits data line
-    sendUpperByte(data_to_LCD);
-
-    toggle();
+    lcd.commandHalf(data_to_LCD);
 }
 
 void putCommand(char data_to_LCD) {
@@ -191,17 +298,7 @@ void putCommand(char data_to_LCD) {
         return;
     }
 
-    registerSelectWrite(LOW);	    // selecting register as command register
-    readWriteWrite(LOW);	    // selecting write mode
-    clear_line();                   // clearing the 4 bits data line
-    sendUpperByte(data_to_LCD);
-
-    toggle();
-
-    clear_line();                   // clearing the 4 bits data line
-    sendLowerByte(data_to_LCD);
-
-    toggle();
+    lcd.command(data_to_LCD);
 }
 
 void writeByte(char data_to_LCD) {
@@ -218,17 +315,7 @@ void writeByte(char data_to_LCD) {
         return;
     }
 
-    registerSelectWrite(HIGH);      // selecting register as data register
-    readWriteWrite(LOW);	        // selecting write mode    
-    clear_line();                   // clearing the 4 bits data line
-    sendUpperByte(data_to_LCD);
-
-    toggle();
-
-    clear_line();                   // clearing the 4 bits data line
-    sendLowerByte(data_to_LCD);
-
-    toggle();
+    lcd.write(data_to_LCD);
 }
 
 void writeString(unsigned char LineOfCharacters[TOTAL_CHARACTERS_OF_LCD], char OverLenghtCharacters) {
@@ -242,17 +329,11 @@ void writeString(unsigned char LineOfCharacters[TOTAL_CHARACTERS_OF_LCD], char O
  *    [in] OverLenghtCharacters - flag to enable wrapping (true = wrapping ON) (false = wrapping OFF)
  *
  ****************************************************************************/
-	unsigned char i=0, line=-1;
-
-	while(LineOfCharacters[i] && i<TOTAL_CHARACTERS_OF_LCD) {
-		if(OverLenghtCharacters) {
-			if((i%LCD_LINE_LENGHT)==0)
-				setCursor(++line, 0);
-		}
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
+    }
 
-		writeByte(LineOfCharacters[i]);
-		i++;
-	}
+    lcd.writeString((const char*)LineOfCharacters, OverLenghtCharacters);
 }
 
 void writeNumber(int number) {
@@ -265,32 +346,11 @@ void writeNumber(int number) {
  *    [in] number - number to be printed
  *
  ****************************************************************************/
-    int index = 0, MAX_NUM_LEN = 10, temp;
-    int digit[MAX_NUM_LEN];
-
-    while(number != 0) {
-        digit[index] = number%10;
-        number/=10;
-        index++;
-    }
-
-    if(index == 0) {
-        writeByte(NUM_TO_CODE(0));  // print number zero
-    }else {
-        /* array inversion algorithm */
-        int cycle;
-        int comodo = index-1;
-        for(cycle = 0; cycle < index-index/2; cycle++) {
-            temp = digit[comodo];
-            digit[comodo] = digit[cycle];
-            digit[cycle] = temp;
-            comodo--;
-        }
-
-        for(cycle = 0; cycle < index; cycle++) {
-            writeByte(NUM_TO_CODE(digit[cycle]));
-        }
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
     }
+
+    lcd.writeNumber(number);
 }
 
 void lcd_rig_sh(void) {
@@ -305,8 +365,7 @@ void lcd_rig_sh(void) {
         return;
     }
 
-	putCommand(DISPLAY_MOVE_SHIFT_RIGHT_CMD);  // command for right shift
-	delayMs(100);
+    lcd.shiftRight();
 }
 
 void lcd_lef_sh(void) {
@@ -320,9 +379,8 @@ void lcd_lef_sh(void) {
     if (registeredCallbacks != E_CALLBACK_NUMBER) {
         return;
     }
-    
-	putCommand(DISPLAY_MOVE_SHIFT_LEFT_CMD);  // command for left shift
-    delayMs(100);
+
+    lcd.shiftLeft();
 }
 
 void setCursor(unsigned char line, unsigned char col) {
@@ -336,34 +394,11 @@ void setCursor(unsigned char line, unsigned char col) {
  *    [in] col - number of the column in which to place the cursor
  *
  ****************************************************************************/
-	unsigned char address;
-
-	switch(line){
-		case 0:
-			address = 0x00;
-			break;
-
-		case 1:
-			address = 0x40;
-			break;
-
-		case 2:
-			address = 0x10;
-			break;
-
-		case 3:
-			address = 0x50;
-			break;
-
-		default:
-			address = 0x00;
-			break;
-	}
-
-	if(col >= 0 && col <= LCD_LINE_LENGHT)
-		address += col;
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
+    }
 
-	putCommand(DDRAM_ADDRESS(address));
+    lcd.setCursor(line, col);
 }
 
 bool register_callback(void (*callback)(int), E_CALLBACK_TYPE type) {
@@ -376,6 +411,10 @@ bool register_callback(void (*callback)(int), E_CALLBACK_TYPE type) {
     if (type < 0 || type >= E_CALLBACK_NUMBER) {
         return false;
     }
+
+    if (busWrite != nullptr && type != E_DELAY) {
+        return false;   // pins already driven by the bus callback
+    }
     
     switch (type)
     {
@@ -453,4 +492,191 @@ bool register_callback(void (*callback)(int), E_CALLBACK_TYPE type) {
     }
 
     return res;
-}
\ No newline at end of file
+}
+
+bool register_bus_callback(set_bus_t callback) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Registers a single callback that drives RS, RW, EN and D4..D7 at once,
+ *    in place of the seven per-pin callbacks (E_DELAY is still required).
+ *    Each nibble then costs three bus writes: data, EN high, EN low.
+ *
+ * Parameters:
+ *    [in] callback - function writing the lines (data: D7..D4 in bits 3..0)
+ *
+ ****************************************************************************/
+    if (callback == nullptr || busWrite != nullptr) {
+        return false;
+    }
+
+    if (registerSelectWrite != nullptr || readWriteWrite != nullptr || enableWrite != nullptr ||
+        dataLine4Write != nullptr || dataLine5Write != nullptr ||
+        dataLine6Write != nullptr || dataLine7Write != nullptr || dataLine0Write != nullptr) {
+        return false;   // per-pin mode already in use
+    }
+
+    busWrite = callback;
+    registeredCallbacks += E_CALLBACK_DATA7 + 1;   // stands for all the pin callbacks
+
+    return true;
+}
+
+bool register_bus8_callback(set_bus_t callback) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Like register_bus_callback, with D0..D3 wired too: the LCD is then
+ *    initialized in 8 bit mode and each byte costs three bus writes
+ *    instead of six
+ *
+ * Parameters:
+ *    [in] callback - function writing the lines (data: D7..D0 in bits 7..0)
+ *
+ ****************************************************************************/
+    if (!register_bus_callback(callback)) {
+        return false;
+    }
+
+    eightBitInterface = true;
+
+    return true;
+}
+
+bool register_data_low_callbacks(set_pin_t dataLine0, set_pin_t dataLine1, set_pin_t dataLine2, set_pin_t dataLine3) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Per-pin callbacks of D0..D3, on top of the register_callback ones:
+ *    the LCD is then initialized in 8 bit mode, with one enable pulse per
+ *    byte. The setDataInput callback of register_read_callback must then
+ *    switch D0..D7.
+ *
+ * Parameters:
+ *    [in] dataLine0..dataLine3 - functions writing D0..D3
+ *
+ ****************************************************************************/
+    if (dataLine0 == nullptr || dataLine1 == nullptr || dataLine2 == nullptr || dataLine3 == nullptr) {
+        return false;
+    }
+
+    if (busWrite != nullptr || dataLine0Write != nullptr) {
+        return false;   // bus mode, or already registered
+    }
+
+    dataLine0Write = dataLine0;
+    dataLine1Write = dataLine1;
+    dataLine2Write = dataLine2;
+    dataLine3Write = dataLine3;
+    eightBitInterface = true;
+
+    return true;
+}
+
+bool register_read_callback(get_pin_t readDataLine7, set_pin_t setDataInput, delay_t delayUs_) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Enables the busy flag read path. The 4 bit initialization sequence
+ *    (putCommand_hf) keeps the timed delays, since BF cannot be read before
+ *    the interface length is set.
+ *
+ * Parameters:
+ *    [in] readDataLine7 - returns the level of D7
+ *    [in] setDataInput - D4..D7 as inputs (1) or outputs (0), can be nullptr
+ *    [in] delayUs_ - microsecond delay for the enable pulse, can be nullptr
+ *
+ ****************************************************************************/
+    if (readDataLine7 == nullptr || dataLine7Read != nullptr) {
+        return false;
+    }
+
+    dataLine7Read = readDataLine7;
+    dataInputWrite = setDataInput;
+    delayUs = delayUs_;
+
+    return true;
+}
+
+void unregister_callbacks(void) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Removes every registered callback (pin, bus and delay), so the driver
+ *    can be bound again, e.g. in the other transfer mode
+ *
+ ****************************************************************************/
+    delayMs = nullptr;
+    registerSelectWrite = nullptr;
+    readWriteWrite = nullptr;
+    enableWrite = nullptr;
+    dataLine4Write = nullptr;
+    dataLine5Write = nullptr;
+    dataLine6Write = nullptr;
+    dataLine7Write = nullptr;
+    dataLine0Write = nullptr;
+    dataLine1Write = nullptr;
+    dataLine2Write = nullptr;
+    dataLine3Write = nullptr;
+    eightBitInterface = false;
+    busWrite = nullptr;
+    dataLine7Read = nullptr;
+    dataInputWrite = nullptr;
+    delayUs = nullptr;
+
+    registeredCallbacks = 0;
+    forgetLines();
+    lcd_invalidate();
+}
+
+void lcd_buffer_clear(void) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Fills the shadow framebuffer with spaces (nothing is sent to the LCD)
+ *
+ ****************************************************************************/
+    lcd.bufferClear();
+}
+
+void lcd_buffer_write(unsigned char line, unsigned char col, const char *str) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes a string in the shadow framebuffer (nothing is sent to the LCD)
+ *
+ * Parameters:
+ *    [in] line - number of the line in which to write
+ *    [in] col - number of the column of the first character
+ *    [in] str - string to write, clipped at the end of the line
+ *
+ ****************************************************************************/
+    lcd.bufferWrite(line, col, str);
+}
+
+void lcd_flush(void) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Brings the LCD up to date with the shadow framebuffer, sending only
+ *    the changed cells: setCursor at the start of each changed run and one
+ *    writeByte per changed character. The display is never cleared.
+ *
+ ****************************************************************************/
+    if (registeredCallbacks != E_CALLBACK_NUMBER) {
+        return;
+    }
+
+    lcd.flush();
+}
+
+void lcd_invalidate(void) {
+/*****************************************************************************
+ *
+ * Description:
+ *    Marks the content of the LCD as unknown, so that the next lcd_flush()
+ *    rewrites every cell (e.g. after the panel has been reset)
+ *
+ ****************************************************************************/
+    lcd.invalidate();
+}
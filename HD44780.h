@@ -8,8 +8,15 @@
 #ifndef __HD44780_H
 #define __HD44780_H
 
-#define TOTAL_CHARACTERS_OF_LCD 32
+#ifndef LCD_LINES
+#define LCD_LINES 2                 // lines of the panel (and of the shadow framebuffer)
+#endif
+
+#ifndef LCD_LINE_LENGHT
 #define LCD_LINE_LENGHT 16
+#endif
+
+#define TOTAL_CHARACTERS_OF_LCD (LCD_LINES*LCD_LINE_LENGHT)
 
 #define IR 0
 #define DR 1
@@ -67,9 +74,13 @@ typedef enum
 
 typedef void (*set_pin_t)(int);
 typedef void (*delay_t)(int);
+typedef void (*set_bus_t)(int rs, int rw, int en, int data);   // data: D7..D4 in bits 3..0 (8 bit: D7..D0)
+typedef int (*get_pin_t)(void);
+
+#define BUSY_POLL_MAX   2000        // busy flag reads before falling back to the timed delay
 
 
-/* NORMAL DISPLAY IN 4BIT MODE */
+/* NORMAL DISPLAY IN 4BIT MODE (8BIT WHEN D0..D3 ARE REGISTERED) */
 //void lcd_pin(int,int,int,int,int,int,int,pin_port,pin_port,pin_port,pin_port,pin_port,pin_port,pin_port);   // LCD pin declaration function
 void init_LCD(void);        					                                                            // LCD initializing function
 void clear_line(void);                                                                                      // function to clear data lines
@@ -85,6 +96,17 @@ void lcd_lef_sh(void);
 void lcd_rig_sh(void);  						                                                            // right shifting function
 void setCursor(unsigned char,unsigned char);
 bool register_callback(void (*callback)(int), E_CALLBACK_TYPE type);	                                                            // function to select the position of cursor
+bool register_bus_callback(set_bus_t callback);                                                             // single callback for RS, RW, EN and D4..D7 (alternative to the pin callbacks)
+bool register_bus8_callback(set_bus_t callback);                                                            // bus callback with D0..D3 too: 8 bit interface
+bool register_data_low_callbacks(set_pin_t, set_pin_t, set_pin_t, set_pin_t);                               // per-pin D0..D3 callbacks: 8 bit interface
+bool register_read_callback(get_pin_t readDataLine7, set_pin_t setDataInput, delay_t delayUs);            // optional D7 read path: poll the busy flag instead of fixed delays
+void unregister_callbacks(void);                                                                            // remove every registered callback
+
+/* SHADOW FRAMEBUFFER */
+void lcd_buffer_clear(void);                                                                                // fill the framebuffer with spaces
+void lcd_buffer_write(unsigned char line, unsigned char col, const char *str);                              // write a string in the framebuffer (clipped at the end of the line)
+void lcd_flush(void);                                                                                       // send only the cells that differ from the panel
+void lcd_invalidate(void);                                                                                  // forget what the panel shows (next flush redraws everything)
 
 
 #endif /* __HD44780_H*/
\ No newline at end of file
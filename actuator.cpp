@@ -0,0 +1,40 @@
+#include "actuator.h"
+
+void ActuatorChannel::configure(int32_t periodUs, const actuator_limits_t &limits, int32_t initialUs)
+{
+    periodUs_ = periodUs;
+    limits_ = limits;
+    widthUs_ = initialUs < 0 ? 0 : (initialUs > periodUs ? periodUs : initialUs);
+    pending_ = true;
+}
+
+bool ActuatorChannel::update(int32_t requestUs)
+{
+    int32_t target = requestUs < 0 ? 0 : (requestUs > periodUs_ ? periodUs_ : requestUs);
+
+    bool first = pending_;          // written anyway, from the width given to configure()
+
+    pending_ = false;
+
+    /* Deadband on the request, so a slew step smaller than the deadband still moves the channel */
+    int32_t change = target > widthUs_ ? target - widthUs_ : widthUs_ - target;
+    bool endpoint = target == 0 || target == periodUs_;
+
+    if (!first && (change == 0 || (change <= limits_.deadbandUs && !endpoint))) {
+        suppressed_++;
+        return false;
+    }
+
+    /* Slew rate: at most slewUsPerTick towards the request */
+    if (limits_.slewUsPerTick > 0) {
+        if (target > widthUs_ + limits_.slewUsPerTick) {
+            target = widthUs_ + limits_.slewUsPerTick;
+        } else if (target < widthUs_ - limits_.slewUsPerTick) {
+            target = widthUs_ - limits_.slewUsPerTick;
+        }
+    }
+
+    widthUs_ = target;
+    issued_++;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <stdint.h>
+
+/* Write policy of a PWM channel, in microseconds of pulse width */
+typedef struct
+{
+    int32_t deadbandUs;             // changes up to this are not written (0: every change)
+    int32_t slewUsPerTick;          // largest change per write() (0: no limit)
+} actuator_limits_t;
+
+/*
+ *  Last pulse width applied to a PWM channel.
+ *
+ *  update() takes the pulse width wanted by the controller and decides
+ *  whether the timer compare register has to be written: a request within
+ *  the deadband of the applied width is dropped, otherwise the applied
+ *  width moves towards it by at most the slew rate. Off and full on (0 and
+ *  the period) are always reached exactly, so a small deadband never
+ *  leaves an actuator slightly on. The first update() after configure()
+ *  always writes, slewing from the width the channel has at that point
+ *  (the boot duty written to the PwmOut, 0 by default).
+ *
+ *  The channel does not touch the hardware: the caller writes width() when
+ *  update() returns true, so the same policy runs on the host tools.
+ */
+class ActuatorChannel {
+public:
+    ActuatorChannel() : limits_({ 0, 0 }), periodUs_(0), widthUs_(0), pending_(true), issued_(0), suppressed_(0) {}
+
+    void configure(int32_t periodUs, const actuator_limits_t &limits, int32_t initialUs = 0);
+
+    bool update(int32_t requestUs);     // true: write width() to the channel
+
+    int32_t width() const { return widthUs_; }     // applied pulse width
+    uint32_t issued() const { return issued_; }
+    uint32_t suppressed() const { return suppressed_; }
+
+private:
+    actuator_limits_t limits_;
+    int32_t periodUs_;
+    int32_t widthUs_;
+    bool pending_;                  // no update() since configure(): the next one writes
+
+    uint32_t issued_;
+    uint32_t suppressed_;
+};
+
+#endif // ACTUATOR_H
@@ -0,0 +1,269 @@
+#include "benchmarks.h"
+#include "pid.h"
+#include "pid_engine.h"
+#include "pid_bank.h"
+#include "HD44780.h"
+#include "lighting.h"
+#include "sensor_acquisition.h"
+#include "zone.h"
+
+#define BENCH_CPU_CALLS     1000        // calls per batch, computation only
+#define BENCH_ZONES_MAX     32          // PID tick scaling: 1, 2, 4 ... zones of 3 loops
+#define BENCH_PWM_PERIOD_US 1000
+
+static volatile float sink;             // keeps the results alive
+static volatile int32_t sinkInt;
+
+static void printNothing(unsigned char *str)
+{
+    (void)str;
+}
+
+/*
+ *  Float acquisition filter (median, then EMA on read() values), the
+ *  reference of the control tick before the integer pipeline
+ */
+struct FloatFilter {
+    float ring[SENSOR_WINDOW];
+    uint32_t next;
+    uint32_t count;
+    float value;
+
+    void add(float raw)
+    {
+        float window[SENSOR_MEDIAN];
+
+        count = count < SENSOR_WINDOW ? count + 1 : count;
+        ring[next] = raw;
+        next = (next + 1) & (SENSOR_WINDOW - 1);
+
+        int n = count < SENSOR_MEDIAN ? count : SENSOR_MEDIAN;
+        for (int i = 0; i < n; i++) {
+            float x = ring[(next - 1 - i) & (SENSOR_WINDOW - 1)];
+            int j = i;
+            while (j > 0 && window[j - 1] > x) {
+                window[j] = window[j - 1];
+                j--;
+            }
+            window[j] = x;
+        }
+
+        value = count == 1 ? window[n / 2] : value + (float)SENSOR_EMA_ALPHA * (window[n / 2] - value);
+    }
+};
+
+static int floatDuty(float output, int periodUs)
+{
+    output = output < 0.0f ? 0.0f : (output > 1.0f ? 1.0f : output);
+    return (int)(output * periodUs);       // PwmOut::write on target
+}
+
+void run_lcd_benchmarks(FILE *out, const bench_probe_t *probe, const char *lcdConfig)
+{
+    char name[48];
+
+    snprintf(name, sizeof(name), "lcd.%s.setCursor", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int i) {
+        setCursor(i & 1, 0);
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeByte", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int i) {
+        writeByte('A' + (i % 26));
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeString", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int) {
+        setCursor(0, 0);
+        writeString((unsigned char*)"Pull Up Night", false);
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeNumber", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int i) {
+        setCursor(1, 0);
+        writeNumber(10000 + i);
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.flush", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int i) {
+        lcd_buffer_clear();
+        lcd_buffer_write(0, 0, (i & 1) ? "Pull Up" : "Pull Down");
+        lcd_flush();
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.redraw", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [](int i) {
+        lcd_invalidate();
+        lcd_buffer_write(0, 0, BENCH_SCREENS[i & 1][0]);
+        lcd_buffer_write(1, 0, BENCH_SCREENS[i & 1][1]);
+        lcd_flush();
+    });
+}
+
+void run_benchmarks(FILE *out, const bench_probe_t *probe, const char *lcdConfig)
+{
+    cycle_counter_init();
+
+    fprintf(out, "benchmark,iterations,cycles_per_call,ns_per_call,callbacks_per_call,delay_us_per_call\n");
+
+    /* Input: measured value oscillating around the setpoint */
+    float input[16];
+    for (int i = 0; i < 16; i++) {
+        input[i] = 0.625f + 0.01f * (i - 8);
+    }
+
+    /*
+     *  Controllers
+     */
+    PID pid(1.0f, 0.0f, 0.5f);
+    bench_case(out, nullptr, "pid.calculate", BENCH_CPU_CALLS, [&](int i) {
+        sink = pid.calculate(0.625f, input[i & 15], 0.01f);
+    });
+
+    constexpr PIDGains gains(1.0f, 0.0f, 0.5f);
+    static_assert(pid_engine_gains_fit(gains, 0.01), "PIDEngine coefficients out of range");
+    PIDEngine<float> pidFloat(PIDEngine<float>::Coefficients(gains, 0.01f));
+    bench_case(out, nullptr, "pid_engine.float", BENCH_CPU_CALLS, [&](int i) {
+        sink = pidFloat.calculate(0.625f, input[i & 15]);
+    });
+
+    PIDEngine<Q15> pid15(PIDEngine<Q15>::Coefficients(gains, 0.01f));
+    const Q15 setpoint15 = Q15::fromFloat(0.625f);
+    Q15 input15[16];
+    for (int i = 0; i < 16; i++) {
+        input15[i] = Q15::fromFloat(input[i]);
+    }
+    bench_case(out, nullptr, "pid_engine.q15", BENCH_CPU_CALLS, [&](int i) {
+        sink = (float)pid15.calculate(setpoint15, input15[i & 15]).raw();
+    });
+
+    /*
+     *  One PID tick of N zones (3 loops each): PID objects against the bank
+     */
+    for (int zones = 1; zones <= BENCH_ZONES_MAX; zones *= 2) {
+        const int loops = zones * 3;
+        char name[48];
+
+        PID *pids[PID_BANK_SIZE];
+        for (int l = 0; l < loops; l++) {
+            pids[l] = new PID(1.0f, 0.0f, 0.5f);
+        }
+        snprintf(name, sizeof(name), "pid.zones_%d", zones);
+        bench_case(out, nullptr, name, BENCH_CPU_CALLS, [&](int i) {
+            for (int l = 0; l < loops; l++) {
+                sink = pids[l]->calculate(0.625f, input[(i + l) & 15], 0.01f);
+            }
+        });
+        for (int l = 0; l < loops; l++) {
+            delete pids[l];
+        }
+
+        PIDBank *bank = new PIDBank;
+        for (int l = 0; l < loops; l++) {
+            bank->add(1.0f, 0.0f, 0.5f, 0.01f);
+        }
+        snprintf(name, sizeof(name), "pid_bank.zones_%d", zones);
+        bench_case(out, nullptr, name, BENCH_CPU_CALLS, [&](int i) {
+            for (int l = 0; l < loops; l++) {
+                bank->input(l, 0.625f, input[(i + l) & 15], true);
+            }
+            bank->calculate();
+            sink = bank->output(loops - 1);
+        });
+        delete bank;
+
+        PIDBankQ15 *bank15 = new PIDBankQ15;
+        for (int l = 0; l < loops; l++) {
+            bank15->add(1.0f, 0.0f, 0.5f, 0.01f);
+        }
+        snprintf(name, sizeof(name), "pid_bank_q15.zones_%d", zones);
+        bench_case(out, nullptr, name, BENCH_CPU_CALLS, [&](int i) {
+            for (int l = 0; l < loops; l++) {
+                bank15->input(l, setpoint15, input15[(i + l) & 15], true);
+            }
+            bank15->calculate();
+            sinkInt = bank15->output(loops - 1).raw();
+        });
+        delete bank15;
+    }
+
+    /*
+     *  Control tick of one zone, conversions excluded: filters of the two
+     *  fast channels, three PID loops, three pulse widths. The float path
+     *  is the one replaced by the integer pipeline (read(), float filters,
+     *  PIDBank, PwmOut::write); on a core without FPU each float operation
+     *  is a library call.
+     */
+    uint16_t counts[16];
+    for (int i = 0; i < 16; i++) {
+        counts[i] = (uint16_t)(input[i] * 65535.0f + 0.5f);
+    }
+
+    FloatFilter lightFloat = {};
+    FloatFilter umidityFloat = {};
+    PIDBank *bankFloat = new PIDBank;
+    bankFloat->add(1.0f, 0.0f, 0.0f, 0.01f);
+    bankFloat->add(1.0f, 0.0f, 0.5f, 0.01f);
+    bankFloat->add(1.0f, 0.0f, 0.0f, 0.01f);
+    bench_case(out, nullptr, "control_tick.float", BENCH_CPU_CALLS, [&](int i) {
+        lightFloat.add(counts[i & 15] * (1.0f / 65535.0f));
+        umidityFloat.add(counts[(i + 5) & 15] * (1.0f / 65535.0f));
+        bankFloat->input(0, 0.625f, lightFloat.value, true);
+        bankFloat->input(1, 0.625f, lightFloat.value, true);
+        bankFloat->input(2, 0.6f, umidityFloat.value, true);
+        bankFloat->calculate();
+        sinkInt = floatDuty(bankFloat->output(0), BENCH_PWM_PERIOD_US) +
+               floatDuty(bankFloat->output(1), BENCH_PWM_PERIOD_US) +
+               floatDuty(bankFloat->output(2), BENCH_PWM_PERIOD_US);
+    });
+    delete bankFloat;
+
+    static constexpr calibration_point_t linear[] = { { 0, 0 }, { 65535, SENSOR_FULL_SCALE } };
+    static constexpr CalibrationTable calibration(linear);
+    SensorFilter lightFilter;
+    SensorFilter umidityFilter;
+    PIDBankQ15 *bankInt = new PIDBankQ15;
+    bankInt->add(1.0f, 0.0f, 0.0f, 0.01f);
+    bankInt->add(1.0f, 0.0f, 0.5f, 0.01f);
+    bankInt->add(1.0f, 0.0f, 0.0f, 0.01f);
+    const Q15 lightReference = Q15::fromRaw(SENSOR_LEVEL(0.625));
+    const Q15 umidityReference = Q15::fromRaw(SENSOR_LEVEL(0.6));
+    bench_case(out, nullptr, "control_tick.int", BENCH_CPU_CALLS, [&](int i) {
+        lightFilter.add(counts[i & 15]);
+        umidityFilter.add(counts[(i + 5) & 15]);
+        Q15 light = Q15::fromRaw(Q15::saturate(calibration.convert(lightFilter.value())));
+        Q15 umidity = Q15::fromRaw(Q15::saturate(calibration.convert(umidityFilter.value())));
+        bankInt->input(0, lightReference, light, true);
+        bankInt->input(1, lightReference, light, true);
+        bankInt->input(2, umidityReference, umidity, true);
+        bankInt->calculate();
+        sinkInt = pulse_width_us(bankInt->output(0), BENCH_PWM_PERIOD_US) +
+                  pulse_width_us(bankInt->output(1), BENCH_PWM_PERIOD_US) +
+                  pulse_width_us(bankInt->output(2), BENCH_PWM_PERIOD_US);
+    });
+    delete bankInt;
+
+    bench_case(out, nullptr, "calibration.convert", BENCH_CPU_CALLS, [&](int i) {
+        sinkInt = calibration.convert(counts[i & 15]);
+    });
+
+    /*
+     *  State machine: day/night decision plus one lighting step
+     */
+    ControlState control = {};
+    LightingMachine steady(LIGHTING_TABLE, E_PULL_UP);
+    E_DAY_NIGHT_STATE dayNight = E_DAY;
+    bench_case(out, nullptr, "state_machine.step", BENCH_CPU_CALLS, [&](int i) {
+        dayNight = getCurrentDayNightState(dayNight, SENSOR_LEVEL(0.5) + SENSOR_LEVEL(0.01) * (i & 7));
+        lighting_context_t ctx = { dayNight, DAYLIGHT_REFERENCE - SENSOR_LEVEL(0.1), &control, printNothing };
+        sink = steady.step(ctx);
+    });
+
+    LightingMachine toggling(LIGHTING_TABLE, E_PULL_UP_NIGHT);
+    bench_case(out, nullptr, "state_machine.transition", BENCH_CPU_CALLS, [&](int i) {
+        lighting_context_t ctx = { (i & 1) ? E_NIGHT : E_DAY, DAYLIGHT_REFERENCE, &control, printNothing };
+        sink = toggling.step(ctx);     // edge 6 and edge 7 in turn
+    });
+
+    run_lcd_benchmarks(out, probe, lcdConfig);
+}
@@ -0,0 +1,123 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cycle_counter.h"
+
+#define BENCH_REPEAT        5           // batches per case, the fastest is reported
+#define BENCH_LCD_CALLS     20          // calls per batch, LCD primitives
+
+/* Full-screen redraw: two 16x2 screens, every cell different */
+static const char *const BENCH_SCREENS[2][2] = {
+    { "Pull Up Night   ", "L 0.625  U 0.500" },
+    { "Pull Down Day  *", "l 0.375  u 0.250" },
+};
+
+/*
+ *  Counters of the LCD callbacks, provided by a mocked bus (host). Without
+ *  a probe only time is measured.
+ */
+typedef struct
+{
+    uint64_t (*callbacks)(void);        // callback invocations so far
+    uint64_t (*delayUs)(void);          // delay requested so far (us)
+} bench_probe_t;
+
+/*
+ *  Microbenchmarks of PID::calculate, the PID engines and banks, one
+ *  control tick on the float and on the integer pipeline, the LCD
+ *  primitives (on the registered callbacks, LCD already initialized) and
+ *  one step of the lighting state machine.
+ *
+ *  One CSV line per case on out, with a header:
+ *      benchmark,iterations,cycles_per_call,ns_per_call,callbacks_per_call,delay_us_per_call
+ *  The callback and delay columns are exact, so they can be diffed between
+ *  commits; cycles and ns depend on the machine.
+ */
+void run_benchmarks(FILE *out, const bench_probe_t *probe, const char *lcdConfig);
+
+/* Only the LCD cases (no header), to compare another callback configuration */
+void run_lcd_benchmarks(FILE *out, const bench_probe_t *probe, const char *lcdConfig);
+
+/*
+ *  One case: work(i) called calls times per batch, one CSV line
+ */
+template <typename Work>
+void bench_case(FILE *out, const bench_probe_t *probe, const char *name, int calls, Work work)
+{
+    cycle_t best = 0;
+    uint64_t callbacks = 0;
+    uint64_t delayUs = 0;
+
+    work(0);                            // warm up (caches, lazy state)
+
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        uint64_t callbacks0 = probe != nullptr ? probe->callbacks() : 0;
+        uint64_t delay0 = probe != nullptr ? probe->delayUs() : 0;
+
+        cycle_t start = cycle_counter_read();
+        for (int i = 0; i < calls; i++) {
+            work(i);
+        }
+        cycle_t elapsed = cycle_counter_read() - start;
+
+        if (r == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        if (probe != nullptr) {
+            callbacks = probe->callbacks() - callbacks0;
+            delayUs = probe->delayUs() - delay0;
+        }
+    }
+
+    double cycles = (double)best / calls;
+    fprintf(out, "%s,%d,%.1f,%.1f,%.2f,%.2f\n", name, calls, cycles, cycles * 1e9 / cycle_counter_hz(),
+            (double)callbacks / calls, (double)delayUs / calls);
+}
+
+/* The LCD cases on an HD44780Driver instance (initialized) */
+template <class Driver>
+void run_driver_benchmarks(FILE *out, const bench_probe_t *probe, const char *lcdConfig, Driver &lcd)
+{
+    char name[48];
+
+    snprintf(name, sizeof(name), "lcd.%s.setCursor", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int i) {
+        lcd.setCursor(i & 1, 0);
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeByte", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int i) {
+        lcd.write('A' + (i % 26));
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeString", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int) {
+        lcd.setCursor(0, 0);
+        lcd.writeString("Pull Up Night");
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.writeNumber", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int i) {
+        lcd.setCursor(1, 0);
+        lcd.writeNumber(10000 + i);
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.flush", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int i) {
+        lcd.bufferClear();
+        lcd.bufferWrite(0, 0, (i & 1) ? "Pull Up" : "Pull Down");
+        lcd.flush();
+    });
+
+    snprintf(name, sizeof(name), "lcd.%s.redraw", lcdConfig);
+    bench_case(out, probe, name, BENCH_LCD_CALLS, [&](int i) {
+        lcd.invalidate();
+        lcd.bufferWrite(0, 0, BENCH_SCREENS[i & 1][0]);
+        lcd.bufferWrite(1, 0, BENCH_SCREENS[i & 1][1]);
+        lcd.flush();
+    });
+}
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,99 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ *  Calibrated sensor values are integers scaled so that SENSOR_FULL_SCALE
+ *  is the full range of the quantity (light: full daylight, umidity:
+ *  100 %RH), the Q15 format of the fixed-point PID. SENSOR_LEVEL turns a
+ *  fraction of the range into a value at compile time, for thresholds and
+ *  references.
+ */
+typedef int32_t sensor_value_t;
+
+#define SENSOR_FULL_SCALE       32768
+#define SENSOR_LEVEL(fraction)  ((sensor_value_t)((fraction) * SENSOR_FULL_SCALE + 0.5))
+
+#define CALIBRATION_SEGMENT_BITS    12      // 16 segments of 4096 counts
+#define CALIBRATION_SEGMENTS        (65536 >> CALIBRATION_SEGMENT_BITS)
+
+/* One point of the sensor characteristic: ADC counts (read_u16) and calibrated value */
+typedef struct
+{
+    uint16_t raw;
+    sensor_value_t value;
+} calibration_point_t;
+
+/*
+ *  Piecewise-linear calibration of a sensor, as a lookup table built at
+ *  compile time from its calibration points.
+ *
+ *  The constructor evaluates the polyline through the points (sorted by
+ *  raw, flat outside them) at the segment ends 0, 4096 ... 65536, so at run
+ *  time a conversion is an index, a multiply and a shift, integer only.
+ *  Points at multiples of 4096 counts are reproduced exactly; elsewhere the
+ *  table interpolates between the segment ends. Adjacent entries must be
+ *  less than 2^19 apart (no overflow of the interpolation product).
+ */
+class CalibrationTable {
+public:
+    template <size_t N>
+    constexpr explicit CalibrationTable(const calibration_point_t (&points)[N])
+        : table_(), valid_(N >= 2)
+    {
+        for (size_t i = 1; i < N; i++) {
+            if (points[i].raw <= points[i - 1].raw) {
+                valid_ = false;
+            }
+        }
+
+        for (int s = 0; s <= CALIBRATION_SEGMENTS; s++) {
+            table_[s] = evaluate(points, N, (int32_t)s << CALIBRATION_SEGMENT_BITS);
+        }
+    }
+
+    /* Points sorted by raw, at least two */
+    constexpr bool valid() const { return valid_; }
+
+    sensor_value_t convert(uint16_t raw) const
+    {
+        int segment = raw >> CALIBRATION_SEGMENT_BITS;
+        int32_t offset = raw & ((1 << CALIBRATION_SEGMENT_BITS) - 1);
+        sensor_value_t low = table_[segment];
+        sensor_value_t high = table_[segment + 1];
+
+        return low + (((high - low) * offset + (1 << (CALIBRATION_SEGMENT_BITS - 1))) >> CALIBRATION_SEGMENT_BITS);
+    }
+
+private:
+    static constexpr sensor_value_t evaluate(const calibration_point_t *points, size_t n, int32_t raw)
+    {
+        if (raw <= points[0].raw) {
+            return points[0].value;
+        }
+
+        for (size_t i = 1; i < n; i++) {
+            if (raw <= points[i].raw) {
+                int64_t span = points[i].raw - points[i - 1].raw;
+                int64_t delta = (int64_t)(points[i].value - points[i - 1].value) * (raw - points[i - 1].raw);
+
+                return points[i - 1].value + (sensor_value_t)((delta + (delta >= 0 ? span / 2 : -span / 2)) / span);
+            }
+        }
+
+        return points[n - 1].value;
+    }
+
+    sensor_value_t table_[CALIBRATION_SEGMENTS + 1];
+    bool valid_;
+};
+
+/* Debug view of a calibrated value (console, telemetry), not used by the control path */
+inline float sensor_float(sensor_value_t value)
+{
+    return (float)value * (1.0f / SENSOR_FULL_SCALE);
+}
+
+#endif // CALIBRATION_H
@@ -4,10 +4,16 @@
 extern DigitalOut registerSelect;
 extern DigitalOut readWrite;
 extern DigitalOut enable;
-extern DigitalOut dataLine4;
-extern DigitalOut dataLine5;
-extern DigitalOut dataLine6;
-extern DigitalOut dataLine7;
+extern DigitalInOut dataLine4;
+extern DigitalInOut dataLine5;
+extern DigitalInOut dataLine6;
+extern DigitalInOut dataLine7;
+#if LCD_EIGHT_BIT
+extern DigitalInOut dataLine0;
+extern DigitalInOut dataLine1;
+extern DigitalInOut dataLine2;
+extern DigitalInOut dataLine3;
+#endif
 
 
 /*
@@ -83,7 +89,155 @@ void setDataLine7(int state)
     }
 }
 
+#if LCD_EIGHT_BIT
+/*
+ *  D0..D3, only wired for the 8 bit interface
+ */
+void setDataLine0(int state)
+{
+    if (state)
+    {
+        dataLine0 = 1;
+    } else {
+        dataLine0 = 0;
+    }
+}
+
+void setDataLine1(int state)
+{
+    if (state)
+    {
+        dataLine1 = 1;
+    } else {
+        dataLine1 = 0;
+    }
+}
+
+void setDataLine2(int state)
+{
+    if (state)
+    {
+        dataLine2 = 1;
+    } else {
+        dataLine2 = 0;
+    }
+}
+
+void setDataLine3(int state)
+{
+    if (state)
+    {
+        dataLine3 = 1;
+    } else {
+        dataLine3 = 0;
+    }
+}
+#endif
+
+/*
+ *  Callback for the whole LCD bus (RS, RW, EN, D4..D7)
+ *
+ *  Only the lines that changed since the previous call are written, and EN
+ *  last, so the data is stable before the rising edge. The driver passes
+ *  the whole bus at every call (its line cache is for the per-pin
+ *  callbacks only), so this is the one cache of the bus mode: 7.9 GPIO
+ *  writes per byte as the per-pin mode, against 42 for a BusOut writing
+ *  every line (host/lcd_bench). The lines span GPIOA, GPIOB and GPIOC on
+ *  the Nucleo header, so no single PortOut write covers them.
+ */
+void setBus(int rs, int rw, int en, int data)
+{
+    static int last = -1;
+    int value = (data & 0x0F) | (rs ? 0x10 : 0) | (rw ? 0x20 : 0) | (en ? 0x40 : 0);
+    int changed = (last < 0) ? 0x7F : (value ^ last);
+
+    last = value;
+
+    if (changed & 0x01) dataLine4 = value & 0x01;
+    if (changed & 0x02) dataLine5 = (value >> 1) & 1;
+    if (changed & 0x04) dataLine6 = (value >> 2) & 1;
+    if (changed & 0x08) dataLine7 = (value >> 3) & 1;
+    if (changed & 0x10) registerSelect = (value >> 4) & 1;
+    if (changed & 0x20) readWrite = (value >> 5) & 1;
+    if (changed & 0x40) enable = (value >> 6) & 1;
+}
+
+#if LCD_EIGHT_BIT
+/*
+ *  Same for the 8 bit interface (RS, RW, EN, D0..D7)
+ */
+void setBus8(int rs, int rw, int en, int data)
+{
+    static int last = -1;
+    int value = (data & 0xFF) | (rs ? 0x100 : 0) | (rw ? 0x200 : 0) | (en ? 0x400 : 0);
+    int changed = (last < 0) ? 0x7FF : (value ^ last);
+
+    last = value;
+
+    if (changed & 0x01) dataLine0 = value & 0x01;
+    if (changed & 0x02) dataLine1 = (value >> 1) & 1;
+    if (changed & 0x04) dataLine2 = (value >> 2) & 1;
+    if (changed & 0x08) dataLine3 = (value >> 3) & 1;
+    if (changed & 0x10) dataLine4 = (value >> 4) & 1;
+    if (changed & 0x20) dataLine5 = (value >> 5) & 1;
+    if (changed & 0x40) dataLine6 = (value >> 6) & 1;
+    if (changed & 0x80) dataLine7 = (value >> 7) & 1;
+    if (changed & 0x100) registerSelect = (value >> 8) & 1;
+    if (changed & 0x200) readWrite = (value >> 9) & 1;
+    if (changed & 0x400) enable = (value >> 10) & 1;
+}
+#endif
+
 void displayDelay(int ms)
 {
     ThisThread::sleep_for(chrono::milliseconds(ms));
-}
\ No newline at end of file
+}
+
+/*
+ *  Read path for the busy flag: D4..D7 are switched to inputs while the LCD
+ *  drives them (RW high)
+ */
+int readDataLine7(void)
+{
+    return dataLine7.read();
+}
+
+void setDataInput(int state)
+{
+    if (state)
+    {
+        dataLine4.input();
+        dataLine5.input();
+        dataLine6.input();
+        dataLine7.input();
+    } else {
+        dataLine4.output();
+        dataLine5.output();
+        dataLine6.output();
+        dataLine7.output();
+    }
+}
+
+#if LCD_EIGHT_BIT
+void setDataInput8(int state)
+{
+    setDataInput(state);
+    if (state)
+    {
+        dataLine0.input();
+        dataLine1.input();
+        dataLine2.input();
+        dataLine3.input();
+    } else {
+        dataLine0.output();
+        dataLine1.output();
+        dataLine2.output();
+        dataLine3.output();
+    }
+}
+#endif
+
+void displayDelayUs(int us)
+{
+    wait_us(us);
+}
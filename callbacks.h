@@ -2,6 +2,17 @@
 
 #include "mbed.h"
 
+/* LCD wiring, shared by main.cpp and the pin callbacks */
+#ifndef LCD_BUS_MODE
+#define LCD_BUS_MODE    1       // 1: single bus callback, 0: one callback per pin
+#endif
+#ifndef LCD_BUSY_FLAG
+#define LCD_BUSY_FLAG   1       // 1: poll the busy flag on D7, 0: fixed 2 ms delays
+#endif
+#ifndef LCD_EIGHT_BIT
+#define LCD_EIGHT_BIT   0       // 1: D0..D3 wired (D2, D4, D14, D15), 8 bit interface
+#endif
+
 void setRegisterSelect(int state);
 void setReadWrite(int state);
 void setEnable(int state);
@@ -9,4 +20,20 @@ void setDataLine4(int state);
 void setDataLine5(int state);
 void setDataLine6(int state);
 void setDataLine7(int state);
-void displayDelay(int ms);
\ No newline at end of file
+#if LCD_EIGHT_BIT
+void setDataLine0(int state);
+void setDataLine1(int state);
+void setDataLine2(int state);
+void setDataLine3(int state);
+#endif
+void setBus(int rs, int rw, int en, int data);
+#if LCD_EIGHT_BIT
+void setBus8(int rs, int rw, int en, int data);
+#endif
+void displayDelay(int ms);
+int readDataLine7(void);
+void setDataInput(int state);
+#if LCD_EIGHT_BIT
+void setDataInput8(int state);
+#endif
+void displayDelayUs(int us);
@@ -0,0 +1,20 @@
+#ifndef CONTROL_STATE_H
+#define CONTROL_STATE_H
+
+#include "seqlock.h"
+#include "calibration.h"
+
+/*
+ *  State decided by the main loop and applied by the PID thread. It is
+ *  published as a whole through a SeqLock, so every PID tick sees references
+ *  and running flags written by the same state machine step.
+ */
+struct ControlState {
+    sensor_value_t lightReference;      // calibrated, as the sensor snapshot
+    sensor_value_t umidityReference;
+    bool pid1Running;           // pull up light    -->     artificialLight
+    bool pid2Running;           // pull down light  -->     electrochromicGlass
+    bool pid3Running;           // umidity          -->     nebulizer
+};
+
+#endif // CONTROL_STATE_H
@@ -0,0 +1,84 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "mbed.h"
+
+/*
+ *  Cycle counter for the benchmarks.
+ *
+ *  On Cortex-M3/M4/M7 it is the DWT cycle counter (32 bit: deltas are
+ *  exact up to 2^32 cycles, about 50 s at 84 MHz). Cortex-M0/M0+ have no
+ *  DWT counter: there it is the microsecond ticker, so only code running
+ *  long enough (a loop of many calls) gives a meaningful count. On the
+ *  host it counts steady clock nanoseconds (a fixed 1 GHz "cycle"): no
+ *  calibration at startup and no dependency on an invariant TSC.
+ */
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+
+typedef uint32_t cycle_t;
+
+inline void cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(__CORTEX_M) && (__CORTEX_M == 7U)
+    DWT->LAR = 0xC5ACCE55;      // Cortex-M7: DWT locked at reset
+#endif
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline cycle_t cycle_counter_read(void)
+{
+    return DWT->CYCCNT;
+}
+
+inline uint32_t cycle_counter_hz(void)
+{
+    return SystemCoreClock;
+}
+
+#elif defined(__MBED__)
+
+#include "hal/us_ticker_api.h"
+
+typedef uint32_t cycle_t;
+
+inline void cycle_counter_init(void)
+{
+    // the ticker layer initializes the us ticker at the first read
+}
+
+inline cycle_t cycle_counter_read(void)
+{
+    return us_ticker_read();
+}
+
+inline uint32_t cycle_counter_hz(void)
+{
+    return 1000000;
+}
+
+#else
+
+#include <chrono>
+
+typedef uint64_t cycle_t;
+
+inline void cycle_counter_init(void)
+{
+}
+
+inline cycle_t cycle_counter_read(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t cycle_counter_hz(void)
+{
+    return 1000000000;
+}
+
+#endif
+
+#endif // CYCLE_COUNTER_H
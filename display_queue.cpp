@@ -0,0 +1,172 @@
+#include "display_queue.h"
+
+#include <string.h>
+
+#define DISPLAY_FLAG_PENDING    0x01
+
+DisplayQueue::DisplayQueue(osPriority priority)
+    : thread_(priority, OS_STACK_SIZE, nullptr, "display"), head_(0), count_(0),
+      maxDepth_(0), enqueued_(0), coalesced_(0), dropped_(0), flushes_(0), latency_(nullptr),
+      splash_(nullptr), splashTime_(0) {
+}
+
+void DisplayQueue::splash(const char *text, Kernel::Clock::duration time)
+{
+    splash_ = text;
+    splashTime_ = time;
+}
+
+void DisplayQueue::start()
+{
+    thread_.start(callback(this, &DisplayQueue::run));
+}
+
+bool DisplayQueue::clear()
+{
+    display_command_t command;
+
+    command.type = E_DISPLAY_CLEAR;
+    command.line = 0;
+    command.column = 0;
+    command.text[0] = '\0';
+
+    return push(command);
+}
+
+bool DisplayQueue::text(int line, int column, const char *text)
+{
+    display_command_t command;
+
+    if (line < 0 || line >= LCD_LINES || column < 0 || column >= LCD_LINE_LENGHT) {
+        return false;
+    }
+
+    command.type = E_DISPLAY_TEXT;
+    command.line = (uint8_t)line;
+    command.column = (uint8_t)column;
+    strncpy(command.text, text, LCD_LINE_LENGHT - column);
+    command.text[LCD_LINE_LENGHT - column] = '\0';
+
+    return push(command);
+}
+
+bool DisplayQueue::message(const char *text)
+{
+    bool queued = clear();
+
+    return this->text(0, 0, text) && queued;
+}
+
+uint32_t DisplayQueue::depth()
+{
+    mutex_.lock();
+    uint32_t count = count_;
+    mutex_.unlock();
+
+    return count;
+}
+
+bool DisplayQueue::push(const display_command_t &command)
+{
+    bool queued = true;
+
+    mutex_.lock();
+
+    /* Coalescing: drop the pending commands the new one overwrites */
+    for (uint32_t i = 0; i < count_;) {
+        const display_command_t &pending = commands_[(head_ + i) % DISPLAY_QUEUE_SIZE];
+
+        if (command.type == E_DISPLAY_CLEAR ||
+            (pending.type == E_DISPLAY_TEXT && pending.line == command.line && pending.column == command.column)) {
+            remove(i);
+            coalesced_++;
+        } else {
+            i++;
+        }
+    }
+
+    if (count_ < DISPLAY_QUEUE_SIZE) {
+        commands_[(head_ + count_) % DISPLAY_QUEUE_SIZE] = command;
+        count_++;
+        enqueued_++;
+        if (count_ > maxDepth_) {
+            maxDepth_ = count_;
+        }
+    } else {
+        dropped_++;
+        queued = false;
+    }
+
+    mutex_.unlock();
+
+    if (queued) {
+        flags_.set(DISPLAY_FLAG_PENDING);
+    }
+
+    return queued;
+}
+
+bool DisplayQueue::pop(display_command_t &command)
+{
+    bool found = false;
+
+    mutex_.lock();
+    if (count_ > 0) {
+        command = commands_[head_];
+        head_ = (head_ + 1) % DISPLAY_QUEUE_SIZE;
+        count_--;
+        found = true;
+    }
+    mutex_.unlock();
+
+    return found;
+}
+
+void DisplayQueue::remove(uint32_t index)
+{
+    /* Called with the mutex held: shift the younger commands down by one */
+    for (uint32_t i = index; i + 1 < count_; i++) {
+        commands_[(head_ + i) % DISPLAY_QUEUE_SIZE] = commands_[(head_ + i + 1) % DISPLAY_QUEUE_SIZE];
+    }
+    count_--;
+}
+
+void DisplayQueue::run()
+{
+    display_command_t command;
+
+    init_LCD();
+
+    if (splash_ != nullptr) {
+        lcd_buffer_clear();
+        lcd_buffer_write(0, 0, splash_);
+        lcd_flush();
+        ThisThread::sleep_for(splashTime_);     // commands keep queueing (and coalescing)
+    }
+
+    while (true) {
+        flags_.wait_any(DISPLAY_FLAG_PENDING);
+
+        while (pop(command)) {
+            switch (command.type)
+            {
+                case E_DISPLAY_CLEAR:
+                    lcd_buffer_clear();
+                    break;
+
+                case E_DISPLAY_TEXT:
+                    lcd_buffer_write(command.line, command.column, command.text);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        {
+            LatencyProbe probe(latency_);
+            lcd_flush();            // only the cells changed by the whole batch
+        }
+        flushes_++;
+    }
+}
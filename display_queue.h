@@ -0,0 +1,82 @@
+#ifndef DISPLAY_QUEUE_H
+#define DISPLAY_QUEUE_H
+
+#include "mbed.h"
+#include "HD44780.h"
+#include "latency.h"
+
+#define DISPLAY_QUEUE_SIZE  8       // pending commands
+
+typedef enum
+{
+    E_DISPLAY_CLEAR,                // blank the whole screen
+    E_DISPLAY_TEXT                  // text field at line, column
+} E_DISPLAY_COMMAND;
+
+typedef struct
+{
+    E_DISPLAY_COMMAND type;
+    uint8_t line;
+    uint8_t column;
+    char text[LCD_LINE_LENGHT + 1];
+} display_command_t;
+
+/*
+ *  Bounded display command queue drained by a low-priority thread.
+ *
+ *  Producers never touch the LCD: they enqueue a command and return. A
+ *  command supersedes the pending ones it would overwrite (a clear drops
+ *  everything queued before it, a text replaces the pending text of the
+ *  same field), so only the latest string is drawn. When the queue is full
+ *  the new command is dropped. The display thread applies the commands to
+ *  the framebuffer and flushes the changed cells.
+ *
+ *  The display thread also initializes the LCD (init_LCD, about 16 ms of
+ *  timed delays) and shows the splash message, so the thread calling
+ *  start() never waits for the panel. Commands queued meanwhile are drawn
+ *  when the splash time is over.
+ */
+class DisplayQueue {
+public:
+    explicit DisplayQueue(osPriority priority = osPriorityLow);
+
+    void splash(const char *text, Kernel::Clock::duration time);   // boot message, before start()
+    void start();                                       // start the display thread (callbacks registered)
+    void profile(LatencyHistogram *histogram) { latency_ = histogram; }     // duration of each lcd_flush
+
+    bool clear();
+    bool text(int line, int column, const char *text);
+    bool message(const char *text);                     // clear + text on the first line
+
+    uint32_t depth();                                   // commands waiting now
+    uint32_t maxDepth() const { return maxDepth_; }
+    uint32_t enqueued() const { return enqueued_; }
+    uint32_t coalesced() const { return coalesced_; }   // removed by a newer command
+    uint32_t dropped() const { return dropped_; }       // rejected, queue full
+    uint32_t flushes() const { return flushes_; }
+
+private:
+    bool push(const display_command_t &command);
+    bool pop(display_command_t &command);
+    void remove(uint32_t index);
+    void run();
+
+    Thread thread_;
+    Mutex mutex_;
+    EventFlags flags_;
+
+    display_command_t commands_[DISPLAY_QUEUE_SIZE];
+    uint32_t head_;
+    uint32_t count_;
+
+    uint32_t maxDepth_;
+    uint32_t enqueued_;
+    uint32_t coalesced_;
+    uint32_t dropped_;
+    uint32_t flushes_;
+    LatencyHistogram *latency_;
+    const char *splash_;
+    Kernel::Clock::duration splashTime_;
+};
+
+#endif // DISPLAY_QUEUE_H
@@ -0,0 +1,78 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/*
+ *  Signed fixed-point number with saturating arithmetic.
+ *
+ *  Storage holds the value scaled by 2^FracBits, Wide is large enough for
+ *  the product of two Storage values. With FracBits = bits of Storage - 1
+ *  (Q15, Q31) the range is [-1, 1). All operations are integer only, so
+ *  they stay cheap on cores without an FPU (Cortex-M0/M0+).
+ */
+template <typename Storage, typename Wide, int FracBits>
+class Fixed {
+public:
+    typedef Storage storage_t;
+    typedef Wide wide_t;
+
+    static const int FRAC_BITS = FracBits;
+    static constexpr Storage RAW_MAX = (Storage)(((Wide)1 << (sizeof(Storage) * 8 - 1)) - 1);
+    static constexpr Storage RAW_MIN = (Storage)(-((Wide)1 << (sizeof(Storage) * 8 - 1)));
+
+    constexpr Fixed() : raw_(0) {}
+
+    static constexpr Fixed fromRaw(Storage raw) { return Fixed(raw, 0); }
+
+    static constexpr Fixed fromFloat(double value)
+    {
+        return fromRaw(saturate(round(value * (double)((Wide)1 << FracBits))));
+    }
+
+    constexpr float toFloat() const { return (float)raw_ / (float)((Wide)1 << FracBits); }
+    constexpr Storage raw() const { return raw_; }
+
+    static constexpr Storage saturate(Wide value)
+    {
+        return value > (Wide)RAW_MAX ? RAW_MAX : (value < (Wide)RAW_MIN ? RAW_MIN : (Storage)value);
+    }
+
+    /* Round to nearest, saturating before the conversion can overflow */
+    static constexpr Wide round(double scaled)
+    {
+        return scaled >= (double)RAW_MAX ? (Wide)RAW_MAX
+             : scaled <= (double)RAW_MIN ? (Wide)RAW_MIN
+             : (Wide)(scaled >= 0.0 ? scaled + 0.5 : scaled - 0.5);
+    }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(saturate((Wide)a.raw_ + b.raw_)); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(saturate((Wide)a.raw_ - b.raw_)); }
+    friend constexpr Fixed operator-(Fixed a) { return fromRaw(saturate(-(Wide)a.raw_)); }
+
+    friend constexpr Fixed operator*(Fixed a, Fixed b)
+    {
+        return fromRaw(saturate(((Wide)a.raw_ * b.raw_ + ((Wide)1 << (FracBits - 1))) >> FracBits));
+    }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw_ == b.raw_; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw_ != b.raw_; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw_ < b.raw_; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw_ > b.raw_; }
+
+private:
+    constexpr Fixed(Storage raw, int) : raw_(raw) {}
+
+    Storage raw_;
+};
+
+template <typename Storage, typename Wide, int FracBits>
+constexpr Storage Fixed<Storage, Wide, FracBits>::RAW_MAX;
+
+template <typename Storage, typename Wide, int FracBits>
+constexpr Storage Fixed<Storage, Wide, FracBits>::RAW_MIN;
+
+typedef Fixed<int16_t, int32_t, 15> Q15;    // 16 bit, resolution 3.1e-5
+typedef Fixed<int32_t, int64_t, 31> Q31;    // 32 bit, resolution 4.7e-10
+
+#endif // FIXED_POINT_H
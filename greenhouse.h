@@ -0,0 +1,80 @@
+#ifndef GREENHOUSE_H
+#define GREENHOUSE_H
+
+#include "actuator.h"
+#include "calibration.h"
+#include "pid_engine.h"
+
+/*
+ *  Configuration of the controller shared by the firmware (main.cpp) and
+ *  the host trace replayer, so a trace is replayed with the rates,
+ *  calibrations and gains it was recorded with.
+ */
+#define PID_RATE_HZ     100
+#define SENSOR_RATE_HZ  PID_RATE_HZ     // a fresh snapshot for every PID period
+#define SENSOR_SLOW_DIV 10      // external light and user references: SENSOR_RATE_HZ / 10
+#define PWM_PERIOD_US   1000    // every actuator
+#define PWM_BOOT_DUTY   1.0f    // written to every actuator at boot, before the first PID tick
+
+/*
+ *  Telemetry/trace UART, TX only (mbed_app.json "telemetry-tx"). Not the
+ *  console's USART2 (D1/D0, ST-LINK port): default USART6 TX, PC_6 on the
+ *  morpho header.
+ */
+#ifdef MBED_CONF_APP_TELEMETRY_TX
+#define TELEMETRY_TX    MBED_CONF_APP_TELEMETRY_TX
+#else
+#define TELEMETRY_TX    PC_6
+#endif
+#define TELEMETRY_BAUD  115200
+
+/* Acquisition channels, in the order they are added */
+typedef enum
+{
+    E_SENSOR_EXTERNAL_LIGHT,
+    E_SENSOR_INTERNAL_LIGHT,
+    E_SENSOR_UMIDITY,
+    E_SENSOR_USER_LIGHT,
+    E_SENSOR_USER_UMIDITY,
+    E_SENSORS
+}E_SENSOR;
+
+/*
+ *  Sensor characteristics: read_u16 counts --> fraction of the range
+ *  (calibration.h). The host plant sensors are linear; a real sensor gets
+ *  the points measured on the bench or taken from its datasheet.
+ */
+constexpr calibration_point_t LIGHT_POINTS[] = { { 0, 0 }, { 65535, SENSOR_FULL_SCALE } };
+constexpr calibration_point_t UMIDITY_POINTS[] = { { 0, 0 }, { 65535, SENSOR_FULL_SCALE } };
+constexpr calibration_point_t KNOB_POINTS[] = { { 0, 0 }, { 65535, SENSOR_FULL_SCALE } };    // user references
+
+constexpr CalibrationTable LIGHT_CALIBRATION(LIGHT_POINTS);
+constexpr CalibrationTable UMIDITY_CALIBRATION(UMIDITY_POINTS);
+constexpr CalibrationTable KNOB_CALIBRATION(KNOB_POINTS);
+
+static_assert(LIGHT_CALIBRATION.valid() && UMIDITY_CALIBRATION.valid() && KNOB_CALIBRATION.valid(),
+              "calibration points");
+
+/* Calibration of every channel, in E_SENSOR order */
+constexpr const CalibrationTable *SENSOR_CALIBRATION[E_SENSORS] = {
+    &LIGHT_CALIBRATION, &LIGHT_CALIBRATION, &UMIDITY_CALIBRATION, &KNOB_CALIBRATION, &KNOB_CALIBRATION
+};
+
+// PID gains of every zone
+constexpr PIDGains PULL_UP_GAINS(1.0, 0.0, 0.0);    // pull up light    -->     artificialLight
+constexpr PIDGains PULL_DOWN_GAINS(1.0, 0.0, 0.5);  // pull down light  -->     electrochromicGlass
+constexpr PIDGains UMIDITY_GAINS(1.0, 0.0, 0.0);    // umidity          -->     nebulizer
+
+static_assert(pid_gains_fit(PULL_UP_GAINS, 1.0 / PID_RATE_HZ) && pid_gains_fit(PULL_DOWN_GAINS, 1.0 / PID_RATE_HZ) &&
+              pid_gains_fit(UMIDITY_GAINS, 1.0 / PID_RATE_HZ), "PID gains out of the PIDBankQ15 coefficient range");
+
+/*
+ *  PWM write limits of every zone (us of PWM_PERIOD_US): deadband and slew
+ *  rate per PID tick. The glass tint is slow and wears with every change,
+ *  a full swing takes 2 s.
+ */
+constexpr actuator_limits_t PULL_UP_LIMITS = { 2, 0 };     // artificialLight
+constexpr actuator_limits_t PULL_DOWN_LIMITS = { 10, 5 };  // electrochromicGlass
+constexpr actuator_limits_t UMIDITY_LIMITS = { 5, 0 };     // nebulizer
+
+#endif // GREENHOUSE_H
@@ -0,0 +1,408 @@
+/*
+ * hd44780_driver.h
+ *
+ *  HD44780 driver bound at compile time to its pins and panel geometry.
+ */
+
+#ifndef HD44780_DRIVER_H
+#define HD44780_DRIVER_H
+
+#include <string.h>
+#include "HD44780.h"
+
+/*
+ *  Panel geometry. Lines 2 and 3 of a 4 line panel continue lines 0 and 1
+ *  in DDRAM, so the address of the first character of a line is known at
+ *  compile time.
+ */
+template <unsigned char Lines, unsigned char Columns>
+struct LcdGeometry {
+    static_assert(Lines >= 1 && Lines <= 4, "HD44780 panels have 1 to 4 lines");
+    static_assert(Columns >= 1 && (Lines <= 2 ? Columns <= 40 : Columns <= 20), "80 characters of DDRAM");
+
+    static const unsigned char LINES = Lines;
+    static const unsigned char COLUMNS = Columns;
+
+    static constexpr unsigned char lineAddress(unsigned char line)
+    {
+        return (unsigned char)(((line & 1) ? 0x40 : 0x00) + ((line & 2) ? Columns : 0));
+    }
+};
+
+typedef LcdGeometry<2, 16> Lcd16x2;
+typedef LcdGeometry<4, 20> Lcd20x4;
+typedef LcdGeometry<2, 40> Lcd40x2;
+
+static_assert(Lcd16x2::lineAddress(1) == 0x40, "setCursor line 1");
+static_assert(Lcd20x4::lineAddress(2) == 0x14 && Lcd20x4::lineAddress(3) == 0x54, "20x4 row offsets");
+
+/*
+ *  Shadow framebuffer of one panel: frame_ holds what the application
+ *  wants on screen, panel_ what the panel is showing ('\0': space in
+ *  frame_, unknown in panel_) and cursor_ the DDRAM address counter.
+ *
+ *  next() gives the transfers that bring the panel up to date, one at a
+ *  time (set DDRAM address at the start of each changed run, then one
+ *  data write per changed cell), and track() follows every transfer sent
+ *  to the panel. A driver flushes by alternating the two, so several
+ *  panels can be brought up to date in turn.
+ */
+template <class Geometry>
+class HD44780Frame {
+public:
+    static const unsigned char LINES = Geometry::LINES;
+    static const unsigned char COLUMNS = Geometry::COLUMNS;
+
+    HD44780Frame() : cursor_(ADDRESS_UNKNOWN), shifted_(false), scan_(0)
+    {
+        memset(frame_, 0, sizeof(frame_));
+        invalidate();
+    }
+
+    void clear()
+    {
+        memset(frame_, ' ', sizeof(frame_));
+        scan_ = 0;
+    }
+
+    void write(unsigned char line, unsigned char col, const char *str)
+    {
+        if (line >= LINES || str == nullptr) {
+            return;
+        }
+
+        unsigned cell = line * COLUMNS + col;
+        if (cell < scan_) {
+            scan_ = cell;
+        }
+        while (*str && col < COLUMNS) {
+            frame_[line][col++] = *str++;
+        }
+    }
+
+    void invalidate()
+    {
+        memset(panel_, 0, sizeof(panel_));
+        cursor_ = ADDRESS_UNKNOWN;
+        scan_ = 0;
+    }
+
+    /* Next transfer to send (rs: IR or DR), false when the panel is up to date */
+    bool next(int &rs, unsigned char &value)
+    {
+        if (shifted_) {
+            rs = IR;
+            value = RETURN_HOME_CMD;        // undo the display shift before addressing cells
+            return true;
+        }
+
+        for (; scan_ < LINES * COLUMNS; scan_++) {
+            unsigned char line = scan_ / COLUMNS;
+            unsigned char col = scan_ % COLUMNS;
+            unsigned char wanted = frame_[line][col] ? frame_[line][col] : ' ';
+
+            if (panel_[line][col] == wanted) {
+                continue;                   // cells before scan_ are up to date
+            }
+
+            unsigned char address = Geometry::lineAddress(line) + col;
+            if (cursor_ != address) {
+                rs = IR;
+                value = 0x80 | address;
+            } else {
+                rs = DR;
+                value = wanted;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    void track(int rs, unsigned char value)
+    {
+        if (rs == DR) {
+            trackData(value);
+        } else {
+            trackCommand(value);
+        }
+    }
+
+private:
+    static const unsigned char ADDRESS_UNKNOWN = 0xFF;
+
+    void trackCommand(unsigned char command)
+    {
+        if (command & 0x80) {                       // set DDRAM address
+            cursor_ = command & 0x7F;
+        } else if (command & 0x40) {                // set CGRAM address: data no longer goes to DDRAM
+            cursor_ = ADDRESS_UNKNOWN;
+        } else if (command & 0x20) {                // function set
+        } else if (command & 0x10) {                // cursor or display shift
+            if (command & 0x08) {
+                shifted_ = true;
+            } else if (cursor_ != ADDRESS_UNKNOWN) {
+                cursor_ += (command & 0x04) ? 1 : -1;
+            }
+        } else if (command & 0x08) {                // display on/off control
+        } else if (command & 0x04) {                // entry mode set
+        } else if (command & 0x02) {                // return home
+            cursor_ = 0x00;
+            shifted_ = false;
+        } else if (command & 0x01) {                // clear display
+            memset(panel_, ' ', sizeof(panel_));
+            scan_ = 0;
+            cursor_ = 0x00;
+            shifted_ = false;
+        }
+    }
+
+    void trackData(unsigned char data)
+    {
+        if (cursor_ == ADDRESS_UNKNOWN) {
+            return;
+        }
+
+        for (unsigned char line = 0; line < LINES; line++) {
+            unsigned char first = Geometry::lineAddress(line);
+            if (cursor_ >= first && cursor_ < first + COLUMNS) {
+                unsigned cell = line * COLUMNS + cursor_ - first;
+
+                panel_[line][cursor_ - first] = data;
+                if (cell < scan_) {
+                    scan_ = cell;
+                }
+                break;
+            }
+        }
+
+        cursor_++;
+        if (cursor_ == 0x28) {
+            cursor_ = 0x40;
+        } else if (cursor_ == 0x68) {
+            cursor_ = 0x00;
+        }
+    }
+
+    unsigned char frame_[LINES][COLUMNS];
+    unsigned char panel_[LINES][COLUMNS];
+    unsigned char cursor_;
+    bool shifted_;
+    unsigned scan_;                 // first cell that may differ
+};
+
+/*
+ *  HD44780 driver in 4 or 8 bit mode, with a shadow framebuffer.
+ *
+ *  Pins is a policy class of static functions:
+ *
+ *      static void lines(int rs, int rw, unsigned char data);     RS, RW and the data lines, EN low
+ *                                              (4 bit: D7..D4 in bits 3..0, 8 bit: D7..D0)
+ *      static void enable(int level);
+ *      static void readMode(int rw);           RS low and RW, data lines unchanged (busy flag reads)
+ *      static bool eightBit();                 true: D0..D3 wired, 8 bit interface (constexpr when known)
+ *      static bool busyFlag();                 true: D7 can be read (constexpr when known)
+ *      static void dataInput(bool input);      data lines direction, for the busy flag reads
+ *      static int  busy();                     level of D7
+ *      static void delayMs(int ms);
+ *      static void delayUs(int us);
+ *
+ *  They are resolved at compile time, so with a policy writing the GPIOs
+ *  directly every pin access inlines to a register write and there is no
+ *  callback check per byte. Each instance owns its framebuffer and cursor,
+ *  so several panels can run at once (one instance per panel).
+ *
+ *  With the busy flag the driver waits before each transfer (polling BF)
+ *  and pulses EN for 1 us, otherwise it sleeps 2 ms after every pulse.
+ *  In 8 bit mode a byte is one EN pulse instead of two, and so is a busy
+ *  flag read.
+ */
+template <class Pins, class Geometry>
+class HD44780Driver {
+public:
+    static const unsigned char LINES = Geometry::LINES;
+    static const unsigned char COLUMNS = Geometry::COLUMNS;
+
+    void init()
+    {
+        commandHalf(0x30);                          // sequence for initialization
+        commandHalf(0x30);
+
+        if (Pins::eightBit()) {
+            commandHalf(0x30);                      // third function set, already 8 bit
+            command(EIGHT_BIT_TWO_LINE_5x8_CMD);    // 4 line panels are two DDRAM lines
+        } else {
+            commandHalf(0x20);                      // 4 bit interface, from now on whole bytes
+            command(FOUR_BIT_TWO_LINE_5x8_CMD);
+        }
+        command(DISP_ON_CUR_OFF_BLINK_OFF_CMD);
+        command(DISPLAY_CLEAR_CMD);
+        command(ENTRY_MODE_INC_NO_SHIFT_CMD);
+        command(0x80);                              // first line, first column
+    }
+
+    /*
+     *  Upper nibble only (the whole byte in 8 bit mode), with the timed
+     *  delay (interface length not set yet: no busy flag)
+     */
+    void commandHalf(unsigned char command)
+    {
+        Pins::lines(IR, 0, Pins::eightBit() ? command : command >> 4);
+        Pins::enable(1);
+        Pins::delayMs(2);
+        Pins::enable(0);
+    }
+
+    void command(unsigned char command)
+    {
+        sendByte(IR, command);
+        frame_.track(IR, command);
+    }
+
+    void write(unsigned char data)
+    {
+        sendByte(DR, data);
+        frame_.track(DR, data);
+    }
+
+    void writeString(const char *str, bool wrap = false)
+    {
+        for (unsigned i = 0; str[i] && i < LINES * COLUMNS; i++) {
+            if (wrap && i % COLUMNS == 0) {
+                setCursor(i / COLUMNS, 0);
+            }
+            write(str[i]);
+        }
+    }
+
+    void writeNumber(int number)
+    {
+        char digits[11];
+        int count = 0;
+        unsigned value = number < 0 ? 0U - (unsigned)number : (unsigned)number;
+
+        do {
+            digits[count++] = NUM_TO_CODE(value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        if (number < 0) {
+            write('-');
+        }
+        while (count > 0) {
+            write(digits[--count]);
+        }
+    }
+
+    void setCursor(unsigned char line, unsigned char col)
+    {
+        unsigned char address = line < LINES ? Geometry::lineAddress(line) : 0x00;
+
+        if (col <= COLUMNS) {
+            address += col;
+        }
+        command(0x80 | address);
+    }
+
+    void shiftLeft()
+    {
+        command(DISPLAY_MOVE_SHIFT_LEFT_CMD);
+        Pins::delayMs(100);
+    }
+
+    void shiftRight()
+    {
+        command(DISPLAY_MOVE_SHIFT_RIGHT_CMD);
+        Pins::delayMs(100);
+    }
+
+    /* Shadow framebuffer (HD44780Frame): flush() sends only the cells that differ */
+    void bufferClear()
+    {
+        frame_.clear();
+    }
+
+    void bufferWrite(unsigned char line, unsigned char col, const char *str)
+    {
+        frame_.write(line, col, str);
+    }
+
+    void flush()
+    {
+        int rs;
+        unsigned char value;
+
+        while (frame_.next(rs, value)) {
+            sendByte(rs, value);
+            frame_.track(rs, value);
+        }
+    }
+
+    void invalidate()
+    {
+        frame_.invalidate();
+    }
+
+private:
+    static void pulse()
+    {
+        Pins::enable(1);
+        if (Pins::busyFlag()) {
+            Pins::delayUs(1);               // PW_EH >= 450 ns, completion seen on BF
+        } else {
+            Pins::delayMs(2);
+        }
+        Pins::enable(0);
+    }
+
+    __attribute__((noinline)) static void waitReady()
+    {
+        int busy = 1;
+
+        Pins::dataInput(true);              // data lines released to the LCD
+        Pins::readMode(1);                  // read busy flag and address counter
+
+        for (int polls = 0; polls < BUSY_POLL_MAX && busy; polls++) {
+            Pins::enable(1);
+            Pins::delayUs(1);               // data output delay tDDR
+            busy = Pins::busy();            // BF, AC6..AC4 (8 bit: the whole AC)
+            Pins::enable(0);
+
+            if (!Pins::eightBit()) {
+                Pins::enable(1);            // AC3..AC0, not needed
+                Pins::delayUs(1);
+                Pins::enable(0);
+            }
+        }
+
+        Pins::readMode(0);
+        Pins::dataInput(false);
+
+        if (busy) {
+            Pins::delayMs(2);
+        }
+    }
+
+    /* Out of line (one copy per instance, pin accesses inlined in it), so the callers stay small */
+    __attribute__((noinline)) static void sendByte(int rs, unsigned char data)
+    {
+        if (Pins::busyFlag()) {
+            waitReady();
+        }
+
+        if (Pins::eightBit()) {
+            Pins::lines(rs, 0, data);
+            pulse();
+            return;
+        }
+
+        Pins::lines(rs, 0, data >> 4);
+        pulse();
+        Pins::lines(rs, 0, data & 0x0F);
+        pulse();
+    }
+
+    HD44780Frame<Geometry> frame_;
+};
+
+#endif // HD44780_DRIVER_H
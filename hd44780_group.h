@@ -0,0 +1,212 @@
+/*
+ * hd44780_group.h
+ *
+ *  Several HD44780 panels on one data bus, with one enable line each.
+ */
+
+#ifndef HD44780_GROUP_H
+#define HD44780_GROUP_H
+
+#include "hd44780_driver.h"
+
+#define HD44780_EXEC_US         50      // instruction and data write, 37/41 us at fosc = 270 kHz
+#define HD44780_EXEC_HOME_US    2000    // clear display and return home, 1.52 ms
+
+/*
+ *  Panels sharing RS, RW and the data lines, each with its own EN and its
+ *  own shadow framebuffer (HD44780Frame).
+ *
+ *  Bus is a policy class like the Pins of HD44780Driver, with the enable
+ *  line of each panel:
+ *
+ *      static const int PANELS;
+ *      static void enable(int panel, int level);
+ *
+ *  A panel only latches the bus on the falling edge of its own EN, so
+ *  while one panel executes an instruction (about 40 us) the bus can carry
+ *  the next transfer of another one. flush() goes round the panels, one
+ *  transfer each: with the busy flag a panel still executing is skipped
+ *  until the next round instead of being polled, without it the round ends
+ *  with a single wait for the slowest instruction it started. The panels
+ *  are brought up to date together, and the time per panel drops as
+ *  panels are added until the bus itself is the limit.
+ *
+ *  init() broadcasts the initialization sequence to every panel at once
+ *  (all EN lines pulsed together), with the timed delays.
+ */
+template <class Bus, class Geometry>
+class HD44780Group {
+public:
+    static const int PANELS = Bus::PANELS;
+    static const unsigned char LINES = Geometry::LINES;
+    static const unsigned char COLUMNS = Geometry::COLUMNS;
+
+    void init()
+    {
+        Bus::delayMs(2);                            // a panel may still be executing (no power cycle)
+        broadcastHalf(0x30);                        // sequence for initialization
+        broadcastHalf(0x30);
+
+        if (Bus::eightBit()) {
+            broadcastHalf(0x30);
+            broadcast(EIGHT_BIT_TWO_LINE_5x8_CMD);
+        } else {
+            broadcastHalf(0x20);                    // 4 bit interface, from now on whole bytes
+            broadcast(FOUR_BIT_TWO_LINE_5x8_CMD);
+        }
+
+        broadcast(DISP_ON_CUR_OFF_BLINK_OFF_CMD);
+        broadcast(DISPLAY_CLEAR_CMD);
+        broadcast(ENTRY_MODE_INC_NO_SHIFT_CMD);
+        broadcast(0x80);                            // first line, first column
+    }
+
+    void bufferClear(int panel)
+    {
+        frames_[panel].clear();
+    }
+
+    void bufferWrite(int panel, unsigned char line, unsigned char col, const char *str)
+    {
+        frames_[panel].write(line, col, str);
+    }
+
+    void invalidate(int panel)
+    {
+        frames_[panel].invalidate();
+    }
+
+    /* Brings every panel up to date with its framebuffer, interleaving the transfers */
+    void flush()
+    {
+        int idleRounds = 0;
+        bool pending = true;
+
+        while (pending) {
+            int longest = 0;
+            bool sent = false;
+
+            pending = false;
+            for (int panel = 0; panel < PANELS; panel++) {
+                int rs;
+                unsigned char value;
+
+                if (!frames_[panel].next(rs, value)) {
+                    continue;
+                }
+                pending = true;
+
+                if (Bus::busyFlag() && idleRounds < BUSY_POLL_MAX && busy(panel)) {
+                    continue;                       // still executing: serve the next panel
+                }
+
+                sendByte(panel, rs, value);
+                frames_[panel].track(rs, value);
+                sent = true;
+
+                int exec = execUs(rs, value);
+                if (exec > longest) {
+                    longest = exec;
+                }
+            }
+
+            if (!Bus::busyFlag()) {
+                if (longest > 0) {
+                    Bus::delayUs(longest);
+                }
+            } else if (sent) {
+                idleRounds = 0;
+            } else if (++idleRounds == BUSY_POLL_MAX) {
+                Bus::delayMs(2);                    // BF stuck: send the next round blind
+            }
+        }
+    }
+
+private:
+    static int execUs(int rs, unsigned char value)
+    {
+        return (rs == IR && value <= RETURN_HOME_CMD) ? HD44780_EXEC_HOME_US : HD44780_EXEC_US;
+    }
+
+    static void pulse(int panel)
+    {
+        Bus::enable(panel, 1);
+        Bus::delayUs(1);                            // PW_EH >= 450 ns
+        Bus::enable(panel, 0);
+    }
+
+    static void pulseAll()
+    {
+        for (int panel = 0; panel < PANELS; panel++) {
+            Bus::enable(panel, 1);
+        }
+        Bus::delayUs(1);
+        for (int panel = 0; panel < PANELS; panel++) {
+            Bus::enable(panel, 0);
+        }
+    }
+
+    /* One busy flag read of a panel: no polling, the caller moves on if it is busy */
+    __attribute__((noinline)) static bool busy(int panel)
+    {
+        Bus::dataInput(true);
+        Bus::readMode(1);
+
+        Bus::enable(panel, 1);
+        Bus::delayUs(1);                            // data output delay tDDR
+        int busy = Bus::busy();
+        Bus::enable(panel, 0);
+
+        if (!Bus::eightBit()) {
+            pulse(panel);                           // AC3..AC0, not needed
+        }
+
+        Bus::readMode(0);
+        Bus::dataInput(false);
+
+        return busy != 0;
+    }
+
+    __attribute__((noinline)) static void sendByte(int panel, int rs, unsigned char data)
+    {
+        if (Bus::eightBit()) {
+            Bus::lines(rs, 0, data);
+            pulse(panel);
+            return;
+        }
+
+        Bus::lines(rs, 0, data >> 4);
+        pulse(panel);
+        Bus::lines(rs, 0, data & 0x0F);
+        pulse(panel);
+    }
+
+    void broadcastHalf(unsigned char command)
+    {
+        Bus::lines(IR, 0, Bus::eightBit() ? command : command >> 4);
+        pulseAll();
+        Bus::delayMs(2);
+    }
+
+    void broadcast(unsigned char command)
+    {
+        if (Bus::eightBit()) {
+            Bus::lines(IR, 0, command);
+            pulseAll();
+        } else {
+            Bus::lines(IR, 0, command >> 4);
+            pulseAll();
+            Bus::lines(IR, 0, command & 0x0F);
+            pulseAll();
+        }
+        Bus::delayMs(2);
+
+        for (int panel = 0; panel < PANELS; panel++) {
+            frames_[panel].track(IR, command);
+        }
+    }
+
+    HD44780Frame<Geometry> frames_[PANELS];
+};
+
+#endif // HD44780_GROUP_H
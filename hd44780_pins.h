@@ -0,0 +1,192 @@
+/*
+ * hd44780_pins.h
+ *
+ *  Pin policy of HD44780Driver bound at compile time to the GPIO objects.
+ */
+
+#ifndef HD44780_PINS_H
+#define HD44780_PINS_H
+
+#include "mbed.h"
+
+/*
+ *  RS, RW and D4..D7 as global DigitalOut/DigitalInOut objects, given as
+ *  template arguments. DigitalOut::write is inline in Mbed (gpio_write,
+ *  one store to the port set/reset register), so every pin access of the
+ *  driver compiles to a register write, with no function pointer and no
+ *  registration check.
+ *
+ *  The policy owns the lines: it remembers the level written on RS, RW and
+ *  D4..D7 and only writes the lines that change. The memory belongs to the
+ *  lines, not to the enable: policies with different EN lines on the same
+ *  RS, RW and D4..D7 (panels on a shared bus) share it. forget() drops it
+ *  when something else has driven the lines.
+ */
+template <DigitalOut &RS, DigitalOut &RW,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7>
+struct HD44780DataPins {
+    static void lines(int rs, int rw, unsigned char nibble)
+    {
+        write(RS, 0, rs);
+        write(RW, 1, rw);
+        write(D4, 2, nibble & 1);
+        write(D5, 3, (nibble >> 1) & 1);
+        write(D6, 4, (nibble >> 2) & 1);
+        write(D7, 5, (nibble >> 3) & 1);
+    }
+
+    static void readMode(int rw)
+    {
+        write(RS, 0, 0);
+        write(RW, 1, rw);
+    }
+
+    static constexpr bool eightBit() { return false; }
+
+    static void dataInput(bool input)
+    {
+        if (input) {
+            D4.input();
+            D5.input();
+            D6.input();
+            D7.input();
+        } else {
+            D4.output();
+            D5.output();
+            D6.output();
+            D7.output();
+        }
+    }
+
+    static int busy() { return D7.read(); }
+    static void delayMs(int ms) { ThisThread::sleep_for(chrono::milliseconds(ms)); }
+    static void delayUs(int us) { wait_us(us); }
+
+    static void forget()
+    {
+        for (int i = 0; i < 6; i++) {
+            levels_[i] = -1;
+        }
+    }
+
+private:
+    template <typename Pin>
+    static void write(Pin &pin, int line, int level)
+    {
+        if (levels_[line] != level) {
+            levels_[line] = level;
+            pin.write(level);
+        }
+    }
+
+    static int levels_[6];          // RS, RW, D4..D7; -1 = unknown
+};
+
+template <DigitalOut &RS, DigitalOut &RW,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7>
+int HD44780DataPins<RS, RW, D4, D5, D6, D7>::levels_[6] = {-1, -1, -1, -1, -1, -1};
+
+/*
+ *  One panel: the lines above plus its EN. BusyFlag selects busy flag
+ *  polling on D7 (D4..D7 must then be DigitalInOut) or the fixed delays.
+ */
+template <DigitalOut &RS, DigitalOut &RW, DigitalOut &EN,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7,
+          bool BusyFlag = true>
+struct HD44780Pins : HD44780DataPins<RS, RW, D4, D5, D6, D7> {
+    static void enable(int level) { EN.write(level); }
+
+    static constexpr bool busyFlag() { return BusyFlag; }
+};
+
+/*
+ *  Panels sharing RS, RW and D4..D7, one EN each (HD44780Group): panel i
+ *  latches the bus on the falling edge of the i-th EN.
+ */
+template <DigitalOut &RS, DigitalOut &RW,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7,
+          bool BusyFlag, DigitalOut &... EN>
+struct HD44780BusPins : HD44780DataPins<RS, RW, D4, D5, D6, D7> {
+    static const int PANELS = sizeof...(EN);
+
+    static void enable(int panel, int level)
+    {
+        DigitalOut *const enables[PANELS] = { &EN... };
+
+        enables[panel]->write(level);
+    }
+
+    static constexpr bool busyFlag() { return BusyFlag; }
+};
+
+/*
+ *  Same policy with D0..D3 wired too: 8 bit interface, one EN pulse per
+ *  byte. The four extra lines cost four more GPIOs.
+ */
+template <DigitalOut &RS, DigitalOut &RW, DigitalOut &EN,
+          DigitalInOut &D0, DigitalInOut &D1, DigitalInOut &D2, DigitalInOut &D3,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7,
+          bool BusyFlag = true>
+struct HD44780Pins8 {
+    static void lines(int rs, int rw, unsigned char data)
+    {
+        write(RS, 0, rs);
+        write(RW, 1, rw);
+        write(D0, 2, data & 1);
+        write(D1, 3, (data >> 1) & 1);
+        write(D2, 4, (data >> 2) & 1);
+        write(D3, 5, (data >> 3) & 1);
+        write(D4, 6, (data >> 4) & 1);
+        write(D5, 7, (data >> 5) & 1);
+        write(D6, 8, (data >> 6) & 1);
+        write(D7, 9, (data >> 7) & 1);
+    }
+
+    static void readMode(int rw)
+    {
+        write(RS, 0, 0);
+        write(RW, 1, rw);
+    }
+
+    static void enable(int level) { EN.write(level); }
+
+    static constexpr bool eightBit() { return true; }
+    static constexpr bool busyFlag() { return BusyFlag; }
+
+    static void dataInput(bool input)
+    {
+        DigitalInOut *const data[8] = { &D0, &D1, &D2, &D3, &D4, &D5, &D6, &D7 };
+
+        for (int i = 0; i < 8; i++) {
+            if (input) {
+                data[i]->input();
+            } else {
+                data[i]->output();
+            }
+        }
+    }
+
+    static int busy() { return D7.read(); }
+    static void delayMs(int ms) { ThisThread::sleep_for(chrono::milliseconds(ms)); }
+    static void delayUs(int us) { wait_us(us); }
+
+private:
+    template <typename Pin>
+    static void write(Pin &pin, int line, int level)
+    {
+        if (levels_[line] != level) {
+            levels_[line] = level;
+            pin.write(level);
+        }
+    }
+
+    static int levels_[10];         // RS, RW, D0..D7; -1 = unknown
+};
+
+template <DigitalOut &RS, DigitalOut &RW, DigitalOut &EN,
+          DigitalInOut &D0, DigitalInOut &D1, DigitalInOut &D2, DigitalInOut &D3,
+          DigitalInOut &D4, DigitalInOut &D5, DigitalInOut &D6, DigitalInOut &D7, bool BusyFlag>
+int HD44780Pins8<RS, RW, EN, D0, D1, D2, D3, D4, D5, D6, D7, BusyFlag>::levels_[10] =
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+#endif // HD44780_PINS_H
@@ -0,0 +1,110 @@
+/*
+ * actuator_test.cpp
+ *
+ *  Checks the write policy of ActuatorChannel: the first write after
+ *  configure(), the deadband, the slew rate and the endpoints (0 and the
+ *  period always reached exactly). Exits with 1 if any check fails.
+ */
+
+#include "actuator.h"
+
+#include <cstdio>
+
+namespace {
+
+const int32_t PERIOD_US = 1000;
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    failures += ok ? 0 : 1;
+}
+
+/* update() result and applied width in one step */
+bool step(ActuatorChannel &channel, int32_t requestUs, bool written, int32_t widthUs)
+{
+    return channel.update(requestUs) == written && channel.width() == widthUs;
+}
+
+void firstWrite()
+{
+    ActuatorChannel channel;
+
+    channel.configure(PERIOD_US, { 10, 0 });
+    check(step(channel, 0, true, 0), "first update writes, even at the applied width");
+    check(step(channel, 0, false, 0), "unchanged request is not written");
+
+    channel.configure(PERIOD_US, { 0, 50 }, PERIOD_US);
+    check(channel.width() == PERIOD_US, "configure() applies the initial width");
+    check(step(channel, 0, true, PERIOD_US - 50), "first update slews from the initial width");
+
+    channel.configure(PERIOD_US, { 0, 0 }, 2 * PERIOD_US);
+    check(channel.width() == PERIOD_US, "initial width clamped to the period");
+}
+
+void deadband()
+{
+    ActuatorChannel channel;
+
+    channel.configure(PERIOD_US, { 10, 0 });
+    channel.update(500);
+    check(step(channel, 510, false, 500), "change within the deadband dropped");
+    check(step(channel, 490, false, 500), "negative change within the deadband dropped");
+    check(step(channel, 511, true, 511), "change beyond the deadband written");
+    check(channel.issued() == 2 && channel.suppressed() == 2, "issued and suppressed counts");
+    check(step(channel, -5, true, 0), "request below 0 clamped, endpoint written");
+}
+
+void slew()
+{
+    ActuatorChannel channel;
+
+    channel.configure(PERIOD_US, { 0, 100 });
+    channel.update(0);
+    check(step(channel, 350, true, 100), "rise limited to the slew step");
+    check(step(channel, 350, true, 200), "second step");
+    check(step(channel, 350, true, 300), "third step");
+    check(step(channel, 350, true, 350), "last step reaches the request");
+    check(step(channel, 0, true, 250), "fall limited to the slew step");
+
+    /* Slew step below the deadband: the deadband is on the request, so the channel still moves */
+    channel.configure(PERIOD_US, { 10, 5 });
+    channel.update(0);
+    check(step(channel, 100, true, 5), "slew step smaller than the deadband moves");
+    check(step(channel, 100, true, 10), "and keeps moving");
+}
+
+void endpoints()
+{
+    ActuatorChannel channel;
+
+    channel.configure(PERIOD_US, { 10, 0 });
+    channel.update(PERIOD_US - 5);
+    check(step(channel, PERIOD_US, true, PERIOD_US), "full on within the deadband written");
+    check(step(channel, 2 * PERIOD_US, false, PERIOD_US), "request above the period clamped");
+
+    channel.update(5);
+    check(step(channel, 0, true, 0), "off within the deadband written");
+
+    channel.configure(PERIOD_US, { 10, 100 });
+    channel.update(0);
+    check(step(channel, PERIOD_US, true, 100), "endpoint still slewed");
+}
+
+} // namespace
+
+int main()
+{
+    printf("ActuatorChannel\n\n");
+
+    firstWrite();
+    deadband();
+    slew();
+    endpoints();
+
+    printf("\n%s\n", failures ? "FAILED" : "ok");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * gain_tuner.cpp
+ *
+ *  Monte Carlo search of the PID gains of the three zone loops.
+ *
+ *  An episode runs one loop closed on a GreenhousePlant: plant sensor
+ *  reading --> 12 bit counts (as the HAL) --> SensorFilter --> calibration
+ *  --> PIDBankQ15 --> pulse width --> ActuatorChannel (deadband and slew
+ *  rate of the loop) --> actuator, at PID_RATE_HZ, from the
+ *  actuator off. These are the classes and the path the firmware zones
+ *  run. The scenario of an episode is randomized from its seed: time of
+ *  day, cloud cover and its variability, humidity disturbances and sensor
+ *  noise.
+ *
+ *  An episode is scored on the true plant value y against the reference
+ *  r (lower is better):
+ *
+ *      SCORE_IAE * mean |y - r|
+ *    + SCORE_SETTLING * settling time / episode length   (last exit from the band)
+ *    + SCORE_OVERSHOOT * overshoot / initial error
+ *    + SCORE_EFFORT * (mean duty + 10 * mean |duty change per tick|)
+ *
+ *  Search: a first round of random candidates over the gain ranges (the
+ *  gains of greenhouse.h are candidate 0), then rounds of Gaussian
+ *  perturbations around the best ones with a shrinking spread. Every
+ *  candidate of a loop is scored on the same scenarios, and the winner is
+ *  checked against the hand-picked gains on scenarios it was not tuned on.
+ *
+ *  Candidates are split across the worker threads. A worker owns its
+ *  plants, filters and banks and writes only the scores of its own
+ *  candidates, so no lock is shared; the result does not depend on the
+ *  number of threads.
+ *
+ *      gain_tuner [-c candidates] [-s scenarios] [-r rounds] [-j threads] [-l loop]
+ *
+ *  loop: 0 pull up light, 1 pull down light, 2 umidity, -1 all (default)
+ */
+
+#include "plant.h"
+#include "greenhouse.h"
+#include "sensor_acquisition.h"
+#include "pid_bank.h"
+#include "zone.h"
+#include "lighting.h"
+#include "supervisor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#undef printf
+
+namespace {
+
+const double DT = 1.0 / PID_RATE_HZ;
+
+const double SCORE_IAE = 4.0;
+const double SCORE_SETTLING = 1.0;
+const double SCORE_OVERSHOOT = 1.0;
+const double SCORE_EFFORT = 0.2;
+
+const double SETTLING_BAND = 0.02;      // |y - r| of a settled loop
+const int ELITES = 8;                   // candidates kept from a round
+const uint32_t VALIDATION_SEED = 1000003;
+
+struct Range {
+    double low;
+    double high;
+};
+
+/* One loop of a zone: actuator, measured quantity, reference and scenario */
+struct LoopSpec {
+    E_ZONE_LOOP loop;
+    const char *name;
+    PIDGains handPicked;
+    actuator_limits_t limits;
+    double seconds;                     // episode length
+    Range kp;
+    Range ki;
+    Range kd;                           // |Kd| / dt < 128 (Q15 coefficients)
+};
+
+const LoopSpec LOOPS[E_ZONE_LOOPS] = {
+    { E_ZONE_PULL_UP,   "pull up light",   PULL_UP_GAINS,   PULL_UP_LIMITS,   60.0,  { 0.0, 8.0 },  { 0.0, 4.0 },  { 0.0, 1.0 } },
+    { E_ZONE_PULL_DOWN, "pull down light", PULL_DOWN_GAINS, PULL_DOWN_LIMITS, 60.0,  { -8.0, 8.0 }, { -4.0, 4.0 }, { -1.0, 1.0 } },
+    { E_ZONE_UMIDITY,   "umidity",         UMIDITY_GAINS,   UMIDITY_LIMITS,   600.0, { 0.0, 8.0 },  { 0.0, 4.0 },  { 0.0, 1.0 } },
+};
+
+struct Metrics {
+    double iae;                         // mean |y - r|
+    double settling;                    // s
+    double overshoot;                   // fraction of the initial error
+    double effort;                      // mean duty
+    double chatter;                     // mean |duty change| per tick
+    double score;
+};
+
+/* Scenario of an episode, from its seed */
+GreenhousePlant::Params scenario(E_ZONE_LOOP loop, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    GreenhousePlant::Params params;
+
+    switch (loop) {
+        case E_ZONE_PULL_UP:                // dim day: morning or evening, clouds
+            params.startHour = u(rng) < 0.5 ? 7.0 + 1.5 * u(rng) : 17.5 + 1.5 * u(rng);
+            params.cloudiness = 0.2 + 0.7 * u(rng);
+            break;
+
+        case E_ZONE_PULL_DOWN:              // bright day: around noon, few clouds
+            params.startHour = 11.0 + 3.0 * u(rng);
+            params.cloudiness = 0.3 * u(rng);
+            break;
+
+        default:                            // dry day
+            params.startHour = 10.0 + 5.0 * u(rng);
+            params.cloudiness = 0.6 * u(rng);
+            break;
+    }
+
+    params.cloudVariability = 0.3 * u(rng);
+    params.cloudTau = 30.0 + 300.0 * u(rng);
+    params.humidityDisturbance = 0.3 * u(rng);
+    params.sensorNoise = 0.01 * u(rng);
+    params.seed = seed;
+
+    return params;
+}
+
+uint16_t counts(double value)
+{
+    unsigned raw = (unsigned)std::lround(value * 4095.0);     // 12 bit converter, left aligned as read_u16
+    return (uint16_t)((raw << 4) | (raw >> 8));
+}
+
+/* Per-thread simulation state of an episode */
+struct Episode {
+    PIDBankQ15 bank;
+    SensorFilter filter;
+
+    Metrics run(const LoopSpec &spec, const PIDGains &gains, uint32_t seed)
+    {
+        GreenhousePlant plant(scenario(spec.loop, seed));
+        GreenhousePlant::Actuators u = { 0.0, 0.0, 0.0 };
+        double &duty = spec.loop == E_ZONE_PULL_UP ? u.artificialLight
+                     : spec.loop == E_ZONE_PULL_DOWN ? u.electrochromicGlass : u.nebulizer;
+        const bool light = spec.loop != E_ZONE_UMIDITY;
+        const sensor_value_t reference = light ? DAYLIGHT_REFERENCE : UMIDITY_REFERENCE;
+        const double r = sensor_float(reference);
+        const CalibrationTable &calibration = light ? LIGHT_CALIBRATION : UMIDITY_CALIBRATION;
+
+        bank = PIDBankQ15();
+        bank.add(gains.kp, gains.ki, gains.kd, (float)DT);
+        filter = SensorFilter();
+        ActuatorChannel channel;
+        channel.configure(PWM_PERIOD_US, spec.limits);
+
+        const int ticks = (int)(spec.seconds * PID_RATE_HZ);
+        const double y0 = light ? plant.internalLight() : plant.humidity();
+        const double step = r - y0;
+        const double band = std::max(SETTLING_BAND, 0.05 * std::fabs(step));
+        double iae = 0.0, effort = 0.0, chatter = 0.0, peak = 0.0;
+        int lastOutside = ticks;
+
+        for (int n = 0; n < ticks; n++) {
+            double reading = light ? plant.readInternalLight() : plant.readHumidity();
+            filter.add(counts(reading));
+            Q15 measured = Q15::fromRaw(Q15::saturate(calibration.convert(filter.value())));
+
+            bank.input(0, Q15::fromRaw(Q15::saturate(reference)), measured, true);
+            bank.calculate();
+
+            double previous = duty;
+            channel.update(pulse_width_us(bank.output(0), PWM_PERIOD_US));
+            duty = (double)channel.width() / PWM_PERIOD_US;
+            plant.step(DT, u);
+
+            double y = light ? plant.internalLight() : plant.humidity();
+            double error = y - r;
+            iae += std::fabs(error);
+            effort += duty;
+            chatter += std::fabs(duty - previous);
+            if (step != 0.0) {
+                peak = std::max(peak, error * (step > 0.0 ? 1.0 : -1.0));
+            }
+            if (std::fabs(error) > band) {
+                lastOutside = n;
+            }
+        }
+
+        Metrics m;
+        m.iae = iae / ticks;
+        m.settling = lastOutside == ticks ? 0.0 : (lastOutside + 1) * DT;
+        m.overshoot = std::fabs(step) > SETTLING_BAND ? peak / std::fabs(step) : 0.0;
+        m.effort = effort / ticks;
+        m.chatter = chatter / ticks;
+        m.score = SCORE_IAE * m.iae + SCORE_SETTLING * m.settling / spec.seconds + SCORE_OVERSHOOT * m.overshoot
+                + SCORE_EFFORT * (m.effort + 10.0 * m.chatter);
+        return m;
+    }
+};
+
+struct Candidate {
+    PIDGains gains = PIDGains(0.0f, 0.0f, 0.0f);
+    Metrics mean = {};
+};
+
+void accumulate(Metrics &sum, const Metrics &m, double weight)
+{
+    sum.iae += m.iae * weight;
+    sum.settling += m.settling * weight;
+    sum.overshoot += m.overshoot * weight;
+    sum.effort += m.effort * weight;
+    sum.chatter += m.chatter * weight;
+    sum.score += m.score * weight;
+}
+
+/* Scores every candidate on scenarios seed0 .. seed0 + scenarios - 1, candidates split across threads */
+void evaluate(const LoopSpec &spec, std::vector<Candidate> &candidates, int scenarios, uint32_t seed0,
+              int threads, std::atomic<uint64_t> &episodes)
+{
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            Episode *episode = new Episode;         // per-thread state (the bank is a few kB)
+            uint64_t count = 0;
+
+            for (size_t c = t; c < candidates.size(); c += threads) {
+                Metrics sum = {};
+                for (int s = 0; s < scenarios; s++) {
+                    accumulate(sum, episode->run(spec, candidates[c].gains, seed0 + s), 1.0 / scenarios);
+                    count++;
+                }
+                candidates[c].mean = sum;
+            }
+
+            episodes.fetch_add(count, std::memory_order_relaxed);
+            delete episode;
+        });
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+double clampRange(double value, const Range &range)
+{
+    return std::min(range.high, std::max(range.low, value));
+}
+
+void printMetrics(const char *name, const Candidate &c)
+{
+    printf("  %-12s kp %7.3f  ki %7.3f  kd %7.3f   score %.4f  iae %.4f  settling %6.1f s  "
+           "overshoot %5.1f %%  duty %.3f  chatter %.4f\n",
+           name, c.gains.kp, c.gains.ki, c.gains.kd, c.mean.score, c.mean.iae, c.mean.settling,
+           100.0 * c.mean.overshoot, c.mean.effort, c.mean.chatter);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int candidatesPerRound = 128;
+    int scenarios = 16;
+    int rounds = 4;
+    int threads = (int)std::thread::hardware_concurrency();
+    int only = -1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-c") == 0) {
+            candidatesPerRound = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            scenarios = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            rounds = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-j") == 0) {
+            threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            only = atoi(argv[i + 1]);
+        }
+    }
+    threads = std::max(1, threads);
+    candidatesPerRound = std::max(ELITES, candidatesPerRound);
+    scenarios = std::max(1, scenarios);
+    rounds = std::max(1, rounds);
+
+    printf("PID gain search: %d candidates x %d scenarios x %d rounds per loop, %d threads\n",
+           candidatesPerRound, scenarios, rounds, threads);
+
+    std::atomic<uint64_t> episodes(0);
+    auto start = std::chrono::steady_clock::now();
+
+    for (const LoopSpec &spec : LOOPS) {
+        if (only >= 0 && spec.loop != only) {
+            continue;
+        }
+
+        std::mt19937 rng(12345 + spec.loop);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::normal_distribution<double> gauss(0.0, 1.0);
+        std::vector<Candidate> candidates(candidatesPerRound);
+        std::vector<Candidate> elites;
+
+        for (int round = 0; round < rounds; round++) {
+            double spread = 0.25 / (1 << round);    // fraction of each range
+
+            for (int c = 0; c < candidatesPerRound; c++) {
+                Candidate &candidate = candidates[c];
+
+                if (round == 0 && c == 0) {
+                    candidate.gains = spec.handPicked;
+                } else if (round == 0) {
+                    candidate.gains = PIDGains(spec.kp.low + (spec.kp.high - spec.kp.low) * u(rng),
+                                               spec.ki.low + (spec.ki.high - spec.ki.low) * u(rng),
+                                               spec.kd.low + (spec.kd.high - spec.kd.low) * u(rng));
+                } else if (c < (int)elites.size()) {
+                    candidate = elites[c];          // kept, scored again on the same scenarios
+                } else {
+                    const PIDGains &parent = elites[c % elites.size()].gains;
+                    candidate.gains = PIDGains(
+                        clampRange(parent.kp + spread * (spec.kp.high - spec.kp.low) * gauss(rng), spec.kp),
+                        clampRange(parent.ki + spread * (spec.ki.high - spec.ki.low) * gauss(rng), spec.ki),
+                        clampRange(parent.kd + spread * (spec.kd.high - spec.kd.low) * gauss(rng), spec.kd));
+                }
+            }
+
+            evaluate(spec, candidates, scenarios, 1, threads, episodes);
+
+            std::sort(candidates.begin(), candidates.end(),
+                      [](const Candidate &a, const Candidate &b) { return a.mean.score < b.mean.score; });
+            elites.assign(candidates.begin(), candidates.begin() + ELITES);
+        }
+
+        /* Hand-picked gains against the winner on scenarios not used by the search */
+        std::vector<Candidate> check(2);
+        check[0].gains = spec.handPicked;
+        check[1].gains = elites[0].gains;
+        evaluate(spec, check, scenarios, VALIDATION_SEED, threads, episodes);
+
+        printf("\n%s (%.0f s episodes, validation scenarios)\n", spec.name, spec.seconds);
+        printMetrics("hand-picked", check[0]);
+        printMetrics("best", check[1]);
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\n%llu episodes in %.2f s: %.0f episodes/s (%d threads)\n", (unsigned long long)episodes.load(),
+           wall, wall > 0 ? episodes.load() / wall : 0.0, threads);
+
+    return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * lcd_bench.cpp
+ *
+ *  GPIO cost of the HD44780 transfer modes: per-pin callbacks
+ *  (register_callback) against the single bus callback
+ *  (register_bus_callback), both bound to the real callbacks.cpp, each
+ *  with fixed 2 ms delays and with busy flag polling
+ *  (register_read_callback), on the 4 bit and on the 8 bit interface
+ *  (register_data_low_callbacks, register_bus8_callback). The pin-bound
+ *  driver template (hd44780_pins.h) runs on the same pins, with no
+ *  callbacks.
+ *
+ *  For each mode it reports, per writeByte, for a full status string and
+ *  for a full-screen redraw (lcd_invalidate and lcd_flush of 16x2
+ *  changed cells), the callback invocations, the GPIO writes reaching the
+ *  pins and the simulated time.
+ *
+ *  Then 1, 2 and 4 panels on the shared bus (EN on D9, PC_0, PC_1, PC_2)
+ *  redraw their whole screen: one driver instance per panel flushed in
+ *  turn, against HD44780Group interleaving the panels.
+ */
+
+#include "mbed.h"
+#include "HD44780.h"
+#include "benchmarks.h"
+#include "callbacks.h"
+#include "hd44780_driver.h"
+#include "hd44780_group.h"
+#include "hd44780_pins.h"
+#include "sim.h"
+
+#undef printf
+
+/* LCD pins used by callbacks.cpp (same wiring as main.cpp) */
+DigitalOut registerSelect(D7);
+DigitalOut readWrite(D8);
+DigitalOut enable(D9);
+DigitalInOut dataLine4(D10, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine5(D11, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine6(D12, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine7(D13, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine0(D2, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine1(D4, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine2(D14, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine3(D15, PIN_OUTPUT, PullNone, 0);
+
+/* EN of the other panels on the shared bus */
+DigitalOut enable1(PC_0);
+DigitalOut enable2(PC_1);
+DigitalOut enable3(PC_2);
+
+namespace {
+
+const int BYTES = 200;
+const int REDRAWS = 10;
+
+uint64_t callbackCalls = 0;
+
+void countRS(int state)    { callbackCalls++; setRegisterSelect(state); }
+void countRW(int state)    { callbackCalls++; setReadWrite(state); }
+void countEN(int state)    { callbackCalls++; setEnable(state); }
+void countD4(int state)    { callbackCalls++; setDataLine4(state); }
+void countD5(int state)    { callbackCalls++; setDataLine5(state); }
+void countD6(int state)    { callbackCalls++; setDataLine6(state); }
+void countD7(int state)    { callbackCalls++; setDataLine7(state); }
+void countD0(int state)    { callbackCalls++; setDataLine0(state); }
+void countD1(int state)    { callbackCalls++; setDataLine1(state); }
+void countD2(int state)    { callbackCalls++; setDataLine2(state); }
+void countD3(int state)    { callbackCalls++; setDataLine3(state); }
+void countBus(int rs, int rw, int en, int data) { callbackCalls++; setBus(rs, rw, en, data); }
+void countBus8(int rs, int rw, int en, int data) { callbackCalls++; setBus8(rs, rw, en, data); }
+
+struct Cost {
+    double calls;
+    double gpioWrites;
+    double ms;
+};
+
+template <typename Work>
+Cost measure(int units, Work work)
+{
+    uint64_t calls = callbackCalls;
+    uint64_t gpio = sim::counters().gpioWrites;
+    sim::sim_time_t start = sim::now();
+
+    for (int i = 0; i < units; i++) {
+        work(i);
+    }
+
+    Cost c;
+    c.calls = (double)(callbackCalls - calls) / units;
+    c.gpioWrites = (double)(sim::counters().gpioWrites - gpio) / units;
+    c.ms = (double)(sim::now() - start) / sim::NS_PER_MS / units;
+
+    return c;
+}
+
+void print(const char *mode, const Cost &byte, const Cost &text, const Cost &redraw)
+{
+    printf("  %-14s %11.1f %10.1f %8.3f %13.1f %12.1f %12.1f %10.1f\n", mode, byte.calls, byte.gpioWrites,
+           byte.ms, text.calls, text.gpioWrites, redraw.gpioWrites, redraw.ms);
+}
+
+void run(const char *mode)
+{
+    const char *status = "Pull Up Night";
+
+    init_LCD();
+
+    Cost byte = measure(BYTES, [](int i) { writeByte('A' + i % 26); });
+    Cost text = measure(10, [status](int) {
+        setCursor(0, 0);
+        writeString((unsigned char *)status, false);
+    });
+
+    Cost redraw = measure(REDRAWS, [](int i) {
+        lcd_invalidate();
+        lcd_buffer_write(0, 0, BENCH_SCREENS[i & 1][0]);
+        lcd_buffer_write(1, 0, BENCH_SCREENS[i & 1][1]);
+        lcd_flush();
+    });
+
+    print(mode, byte, text, redraw);
+}
+
+/* Same measurements on a template instance bound to the pins */
+template <class Pins>
+void runTemplate(const char *mode)
+{
+    static HD44780Driver<Pins, Lcd16x2> lcd;
+    const char *status = "Pull Up Night";
+
+    lcd.init();
+
+    Cost byte = measure(BYTES, [](int i) { lcd.write('A' + i % 26); });
+    Cost text = measure(10, [status](int) {
+        lcd.setCursor(0, 0);
+        lcd.writeString(status);
+    });
+    Cost redraw = measure(REDRAWS, [](int i) {
+        lcd.invalidate();
+        lcd.bufferWrite(0, 0, BENCH_SCREENS[i & 1][0]);
+        lcd.bufferWrite(1, 0, BENCH_SCREENS[i & 1][1]);
+        lcd.flush();
+    });
+
+    print(mode, byte, text, redraw);
+}
+
+template <bool BusyFlag>
+using Pins4 = HD44780Pins<registerSelect, readWrite, enable, dataLine4, dataLine5, dataLine6, dataLine7, BusyFlag>;
+
+template <bool BusyFlag, DigitalOut &EN>
+using Pins4Enable = HD44780Pins<registerSelect, readWrite, EN, dataLine4, dataLine5, dataLine6, dataLine7, BusyFlag>;
+
+template <bool BusyFlag>
+using Pins8 = HD44780Pins8<registerSelect, readWrite, enable, dataLine0, dataLine1, dataLine2, dataLine3,
+                           dataLine4, dataLine5, dataLine6, dataLine7, BusyFlag>;
+
+/*
+ *  Panels on the shared bus: one HD44780Driver per panel, flushed one
+ *  after the other
+ */
+template <bool BusyFlag, DigitalOut &EN>
+HD44780Driver<Pins4Enable<BusyFlag, EN>, Lcd16x2> &panelDriver()
+{
+    static HD44780Driver<Pins4Enable<BusyFlag, EN>, Lcd16x2> lcd;
+    return lcd;
+}
+
+template <bool BusyFlag, DigitalOut &EN>
+int redrawPanel(int screen)
+{
+    HD44780Driver<Pins4Enable<BusyFlag, EN>, Lcd16x2> &lcd = panelDriver<BusyFlag, EN>();
+
+    lcd.invalidate();
+    lcd.bufferWrite(0, 0, BENCH_SCREENS[screen][0]);
+    lcd.bufferWrite(1, 0, BENCH_SCREENS[screen][1]);
+    lcd.flush();
+
+    return 0;
+}
+
+void printShared(const char *mode, int panels, const Cost &redraw)
+{
+    printf("  %-14s %6d %12.2f %12.3f %12.1f\n", mode, panels, redraw.ms, redraw.ms / panels, redraw.gpioWrites);
+}
+
+template <bool BusyFlag, DigitalOut &... EN>
+void runSerial(const char *mode)
+{
+    int init[] = { (panelDriver<BusyFlag, EN>().init(), 0)... };
+    (void)init;
+
+    Cost redraw = measure(REDRAWS, [](int i) {
+        int done[] = { redrawPanel<BusyFlag, EN>(i & 1)... };
+        (void)done;
+    });
+
+    printShared(mode, sizeof...(EN), redraw);
+}
+
+/* Same panels driven by one HD44780Group */
+template <bool BusyFlag, DigitalOut &... EN>
+void runGroup(const char *mode)
+{
+    typedef HD44780BusPins<registerSelect, readWrite, dataLine4, dataLine5, dataLine6, dataLine7, BusyFlag, EN...> Bus;
+    static HD44780Group<Bus, Lcd16x2> group;
+
+    group.init();
+
+    Cost redraw = measure(REDRAWS, [](int i) {
+        for (int panel = 0; panel < Bus::PANELS; panel++) {
+            group.invalidate(panel);
+            group.bufferWrite(panel, 0, 0, BENCH_SCREENS[i & 1][0]);
+            group.bufferWrite(panel, 1, 0, BENCH_SCREENS[i & 1][1]);
+        }
+        group.flush();
+    });
+
+    printShared(mode, Bus::PANELS, redraw);
+}
+
+template <bool BusyFlag>
+void runShared()
+{
+    const char *serial = BusyFlag ? "drivers+bf" : "drivers";
+    const char *group = BusyFlag ? "group+bf" : "group";
+
+    runSerial<BusyFlag, enable>(serial);
+    runGroup<BusyFlag, enable>(group);
+    runSerial<BusyFlag, enable, enable1>(serial);
+    runGroup<BusyFlag, enable, enable1>(group);
+    runSerial<BusyFlag, enable, enable1, enable2, enable3>(serial);
+    runGroup<BusyFlag, enable, enable1, enable2, enable3>(group);
+}
+
+void registerPins(bool eightBit)
+{
+    register_callback(countRS, E_CALLBACK_RS);
+    register_callback(countRW, E_CALLBACK_RW);
+    register_callback(countEN, E_CALLBACK_EN);
+    register_callback(countD4, E_CALLBACK_DATA4);
+    register_callback(countD5, E_CALLBACK_DATA5);
+    register_callback(countD6, E_CALLBACK_DATA6);
+    register_callback(countD7, E_CALLBACK_DATA7);
+    if (eightBit) {
+        register_data_low_callbacks(countD0, countD1, countD2, countD3);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    sim::setDuration(1e6);
+
+    printf("HD44780 transfer modes (writeByte averaged over %d bytes, redraw over %d full screens)\n\n",
+           BYTES, REDRAWS);
+    printf("  %-14s %11s %10s %8s %13s %12s %12s %10s\n", "mode", "calls/byte", "gpio/byte", "ms/byte",
+           "calls/status", "gpio/status", "gpio/redraw", "ms/redraw");
+
+    for (int eightBit = 0; eightBit < 2; eightBit++) {
+        for (int busy = 0; busy < 2; busy++) {
+            set_pin_t dataInput = eightBit ? setDataInput8 : setDataInput;
+            char mode[16];
+
+            unregister_callbacks();
+            registerPins(eightBit);
+            register_callback(displayDelay, E_DELAY);
+            if (busy) {
+                register_read_callback(readDataLine7, dataInput, displayDelayUs);
+            }
+            snprintf(mode, sizeof(mode), "per-pin%s%s", eightBit ? "8" : "", busy ? "+bf" : "");
+            run(mode);
+
+            unregister_callbacks();
+            if (eightBit) {
+                register_bus8_callback(countBus8);
+            } else {
+                register_bus_callback(countBus);
+            }
+            register_callback(displayDelay, E_DELAY);
+            if (busy) {
+                register_read_callback(readDataLine7, dataInput, displayDelayUs);
+            }
+            snprintf(mode, sizeof(mode), "bus%s%s", eightBit ? "8" : "", busy ? "+bf" : "");
+            run(mode);
+        }
+    }
+
+    unregister_callbacks();
+    runTemplate<Pins4<false> >("template");
+    runTemplate<Pins4<true> >("template+bf");
+    runTemplate<Pins8<false> >("template8");
+    runTemplate<Pins8<true> >("template8+bf");
+
+    /* The 8 bit policy moved D4..D7 behind the back of the 4 bit ones */
+    HD44780DataPins<registerSelect, readWrite, dataLine4, dataLine5, dataLine6, dataLine7>::forget();
+
+    printf("\nPanels on the shared bus (full-screen redraw of every panel, averaged over %d)\n\n", REDRAWS);
+    printf("  %-14s %6s %12s %12s %12s\n", "mode", "panels", "ms/redraw", "ms/panel", "gpio/redraw");
+    runShared<false>();
+    runShared<true>();
+
+    printf("\n");
+    sim::finish();
+}
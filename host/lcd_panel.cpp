@@ -0,0 +1,209 @@
+/*
+ * lcd_panel.cpp
+ *
+ *  HD44780 controller model (see lcd_panel.h)
+ */
+
+#include "lcd_panel.h"
+
+#include <cstring>
+
+HD44780Panel::HD44780Panel(int columns, int rows)
+    : columns_(columns), rows_(rows), enableRise_(0), busyUntil_(0),
+      eightBit_(true), twoLines_(true), nibblePending_(false), upperNibble_(0), readPending_(false),
+      increment_(true), cgram_(false), address_(0) {
+    memset(lines_, 0, sizeof(lines_));
+    memset(ddram_, ' ', sizeof(ddram_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+void HD44780Panel::write(int line, int level, int64_t now)
+{
+    if (line < 0 || line >= E_LINE_NUMBER) {
+        return;
+    }
+
+    int previous = lines_[line];
+    lines_[line] = level ? 1 : 0;
+
+    if (line != E_LINE_EN || previous == lines_[line]) {
+        return;
+    }
+
+    if (lines_[E_LINE_EN]) {
+        enableRise_ = now;
+        if (lines_[E_LINE_RW] && !lines_[E_LINE_RS] && !readPending_) {
+            stats_.busyReads++;
+        }
+        return;
+    }
+
+    if (now - enableRise_ < PW_EH_NS) {
+        stats_.shortPulses++;
+    }
+
+    if (lines_[E_LINE_RW]) {
+        if (!eightBit_) {
+            readPending_ = !readPending_;
+        }
+    } else {
+        enableFalling(now);
+    }
+}
+
+int HD44780Panel::read(int line, int64_t now) const
+{
+    if (!lines_[E_LINE_RW] || !lines_[E_LINE_EN] || line < E_LINE_DB0) {
+        return lines_[line];
+    }
+
+    uint8_t value;
+    if (lines_[E_LINE_RS]) {
+        value = ddram_[address_ & 0x7F];
+    } else {
+        value = (busy(now) ? 0x80 : 0x00) | (address_ & 0x7F);
+    }
+
+    int bit = line - E_LINE_DB0;
+    if (!eightBit_) {
+        if (line < E_LINE_DB4) {
+            return lines_[line];
+        }
+        bit = readPending_ ? bit - 4 : bit;
+    }
+
+    return (value >> bit) & 1;
+}
+
+uint8_t HD44780Panel::busBits(int first, int count) const
+{
+    uint8_t value = 0;
+
+    for (int i = 0; i < count; i++) {
+        value |= lines_[first + i] << i;
+    }
+
+    return value;
+}
+
+void HD44780Panel::enableFalling(int64_t now)
+{
+    if (busy(now)) {
+        stats_.lostWrites++;
+        return;
+    }
+
+    bool data = lines_[E_LINE_RS];
+
+    if (eightBit_) {
+        execute(data, busBits(E_LINE_DB0, 8), now);
+        return;
+    }
+
+    uint8_t nibble = busBits(E_LINE_DB4, 4);
+    if (!nibblePending_) {
+        upperNibble_ = nibble;
+        nibblePending_ = true;
+    } else {
+        nibblePending_ = false;
+        execute(data, (upperNibble_ << 4) | nibble, now);
+    }
+}
+
+void HD44780Panel::execute(bool data, uint8_t value, int64_t now)
+{
+    int64_t time = EXEC_TIME_NS;
+
+    if (data) {
+        stats_.dataWrites++;
+        if (!cgram_) {
+            ddram_[address_ & 0x7F] = value;
+        }
+        advanceAddress();
+        time = EXEC_TIME_DATA_NS;
+    } else {
+        stats_.instructions++;
+
+        if (value & 0x80) {             // set DDRAM address
+            address_ = value & 0x7F;
+            cgram_ = false;
+        } else if (value & 0x40) {      // set CGRAM address
+            cgram_ = true;
+        } else if (value & 0x20) {      // function set
+            eightBit_ = (value & 0x10) != 0;
+            twoLines_ = (value & 0x08) != 0;
+            nibblePending_ = false;
+            readPending_ = false;
+        } else if (value & 0x10) {      // cursor/display shift
+        } else if (value & 0x08) {      // display on/off control
+        } else if (value & 0x04) {      // entry mode set
+            increment_ = (value & 0x02) != 0;
+        } else if (value & 0x02) {      // return home
+            address_ = 0;
+            cgram_ = false;
+            time = EXEC_TIME_CLEAR_NS;
+        } else if (value & 0x01) {      // clear display
+            memset(ddram_, ' ', sizeof(ddram_));
+            address_ = 0;
+            cgram_ = false;
+            increment_ = true;
+            stats_.clears++;
+            time = EXEC_TIME_CLEAR_NS;
+        }
+    }
+
+    busyUntil_ = now + time;
+    stats_.busyTime += time;
+}
+
+void HD44780Panel::advanceAddress()
+{
+    if (increment_) {
+        address_++;
+        if (twoLines_ && address_ == 0x28) {
+            address_ = 0x40;
+        } else if (address_ >= (twoLines_ ? 0x68 : 0x50)) {
+            address_ = 0x00;
+        }
+    } else {
+        if (address_ == 0x00) {
+            address_ = twoLines_ ? 0x67 : 0x4F;
+        } else if (twoLines_ && address_ == 0x40) {
+            address_ = 0x27;
+        } else {
+            address_--;
+        }
+    }
+}
+
+std::string HD44780Panel::row(int r) const
+{
+    std::string text;
+    int base = (r % 2 ? 0x40 : 0x00) + (r / 2) * columns_;
+
+    for (int c = 0; c < columns_; c++) {
+        char ch = (char)ddram_[(base + c) & 0x7F];
+        text += (ch >= 0x20 && ch <= 0x7E) ? ch : '?';
+    }
+
+    return text;
+}
+
+void HD44780Panel::report(FILE *out, const char *name) const
+{
+    fprintf(out, "lcd %s (%dx%d)\n", name, columns_, rows_);
+    fprintf(out, "  instructions      : %llu\n", (unsigned long long)stats_.instructions);
+    fprintf(out, "  data writes       : %llu\n", (unsigned long long)stats_.dataWrites);
+    fprintf(out, "  clears            : %llu\n", (unsigned long long)stats_.clears);
+    fprintf(out, "  busy flag reads   : %llu\n", (unsigned long long)stats_.busyReads);
+    fprintf(out, "  lost writes       : %llu\n", (unsigned long long)stats_.lostWrites);
+    fprintf(out, "  short EN pulses   : %llu\n", (unsigned long long)stats_.shortPulses);
+    fprintf(out, "  controller busy   : %.6f s\n", stats_.busyTime / 1e9);
+
+    std::string border = "  +" + std::string(columns_, '-') + "+\n";
+    fputs(border.c_str(), out);
+    for (int r = 0; r < rows_; r++) {
+        fprintf(out, "  |%s|\n", row(r).c_str());
+    }
+    fputs(border.c_str(), out);
+}
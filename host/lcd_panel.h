@@ -0,0 +1,90 @@
+/*
+ * lcd_panel.h
+ *
+ *  Model of an HD44780 controller attached to simulated GPIO lines.
+ *
+ *  Instructions are latched on the falling edge of EN (4-bit or 8-bit
+ *  interface) and executed with the datasheet timings (fosc = 270 kHz).
+ *  Writes that arrive while the controller is still busy are lost, as on
+ *  the real part, and counted, so a driver that does not wait long enough
+ *  shows up in the report instead of silently passing.
+ */
+
+#ifndef LCD_PANEL_H
+#define LCD_PANEL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class HD44780Panel {
+public:
+    typedef enum
+    {
+        E_LINE_RS = 0,
+        E_LINE_RW,
+        E_LINE_EN,
+        E_LINE_DB0,
+        E_LINE_DB1,
+        E_LINE_DB2,
+        E_LINE_DB3,
+        E_LINE_DB4,
+        E_LINE_DB5,
+        E_LINE_DB6,
+        E_LINE_DB7,
+        E_LINE_NUMBER
+    } E_LINE;
+
+    struct Stats {
+        uint64_t instructions;      // executed instructions
+        uint64_t dataWrites;        // executed DDRAM/CGRAM writes
+        uint64_t clears;            // executed display clears
+        uint64_t busyReads;         // busy flag reads
+        uint64_t lostWrites;        // writes ignored because the controller was busy
+        uint64_t shortPulses;       // EN pulses shorter than PW_EH
+        int64_t  busyTime;          // total execution time [ns]
+    };
+
+    static const int64_t EXEC_TIME_NS       = 37000;    // most instructions
+    static const int64_t EXEC_TIME_DATA_NS  = 41000;    // data write (37 us + tADD)
+    static const int64_t EXEC_TIME_CLEAR_NS = 1520000;  // clear display, return home
+    static const int64_t PW_EH_NS           = 450;      // minimum enable pulse width
+
+    HD44780Panel(int columns = 16, int rows = 2);
+
+    void write(int line, int level, int64_t now);   // MCU drives a line
+    int read(int line, int64_t now) const;          // MCU samples a line
+
+    bool busy(int64_t now) const { return now < busyUntil_; }
+    std::string row(int r) const;
+    const Stats &stats() const { return stats_; }
+    void report(FILE *out, const char *name) const;
+
+private:
+    void enableFalling(int64_t now);
+    void execute(bool data, uint8_t value, int64_t now);
+    void advanceAddress();
+    uint8_t busBits(int first, int count) const;
+
+    int columns_;
+    int rows_;
+
+    int lines_[E_LINE_NUMBER];
+    int64_t enableRise_;
+    int64_t busyUntil_;
+
+    bool eightBit_;
+    bool twoLines_;
+    bool nibblePending_;
+    uint8_t upperNibble_;
+    bool readPending_;              // 4-bit reads transfer the upper nibble first
+
+    bool increment_;
+    bool cgram_;
+    uint8_t address_;
+    uint8_t ddram_[128];
+
+    Stats stats_;
+};
+
+#endif // LCD_PANEL_H
@@ -0,0 +1,437 @@
+/*
+ * mbed.h
+ *
+ *  Host stand-in for the subset of the Mbed OS 6 API used by the controller.
+ *
+ *  The classes keep the Mbed signatures, so main.cpp, pid.cpp, callbacks.cpp
+ *  and HD44780.cpp build unchanged on Linux. Behind them, mbed_hal.cpp wires
+ *  the pins to the greenhouse plant model and to an HD44780 panel model, and
+ *  sim.cpp runs the RTOS threads on a virtual clock.
+ */
+
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <sys/types.h>
+
+namespace sim {
+struct Task;
+}
+
+/*
+ *  Pins (Arduino header names of the Nucleo boards, plus a few morpho
+ *  header pins)
+ */
+typedef enum
+{
+    D0, D1, D2, D3, D4, D5, D6, D7,
+    D8, D9, D10, D11, D12, D13, D14, D15,
+    A0, A1, A2, A3, A4, A5,
+    PC_0, PC_1, PC_2, PC_3,
+    PC_6, PC_7,                 // USART6 on the morpho header
+    LED1,
+    BUTTON1,
+    PIN_NUMBER,
+    NC = -1,
+
+    /* USART2 (PA_2/PA_3): the ST-LINK virtual COM port, also on D1/D0 */
+    CONSOLE_TX = D1,
+    CONSOLE_RX = D0,
+    USBTX = CONSOLE_TX,
+    USBRX = CONSOLE_RX
+} PinName;
+
+#define MBED_ASSERT(expr)   assert(expr)
+
+typedef enum
+{
+    PIN_INPUT,
+    PIN_OUTPUT
+} PinDirection;
+
+typedef enum
+{
+    PullNone,
+    PullUp,
+    PullDown
+} PinMode;
+
+/*
+ *  CMSIS-RTOS2 subset
+ */
+typedef enum
+{
+    osPriorityIdle          = 1,
+    osPriorityLow           = 8,
+    osPriorityBelowNormal   = 16,
+    osPriorityNormal        = 24,
+    osPriorityAboveNormal   = 32,
+    osPriorityHigh          = 40,
+    osPriorityRealtime      = 48
+} osPriority;
+
+typedef int32_t osStatus;
+
+#define osOK            0
+#define osWaitForever       0xFFFFFFFFU
+#define osFlagsError        0x80000000U
+#define osFlagsErrorTimeout 0xFFFFFFFEU
+#define OS_STACK_SIZE   4096
+
+namespace mbed {
+
+template <typename F>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() {}
+
+    template <typename F, typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, Callback>::value>::type>
+    Callback(F f) : f_(f) {}
+
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)(Args...))
+        : f_([obj, method](Args... args) { return (obj->*method)(args...); }) {}
+
+    R operator()(Args... args) const { return f_(args...); }
+    explicit operator bool() const { return (bool)f_; }
+
+private:
+    std::function<R(Args...)> f_;
+};
+
+template <typename R, typename... Args>
+Callback<R(Args...)> callback(R (*f)(Args...))
+{
+    return Callback<R(Args...)>(f);
+}
+
+template <typename T, typename U, typename R, typename... Args>
+Callback<R(Args...)> callback(U *obj, R (T::*method)(Args...))
+{
+    return Callback<R(Args...)>(obj, method);
+}
+
+class AnalogIn {
+public:
+    AnalogIn(PinName pin, float vref = 3.3f) : pin_(pin) { (void)vref; }
+
+    float read();
+    unsigned short read_u16();
+    operator float() { return read(); }
+
+private:
+    PinName pin_;
+};
+
+/*
+ *  Sleep manager: while any lock is held the idle thread only sleeps, else
+ *  it enters deep sleep when the next wake-up is far enough (sim.h). The HAL
+ *  objects hold a lock as on target: a running Timer, an attached Ticker or
+ *  Timeout, a PwmOut (until suspend()), a BufferedSerial with input enabled
+ *  or data to send. LowPowerTimer/Ticker/Timeout run in deep sleep.
+ */
+void sleep_manager_lock_deep_sleep();
+void sleep_manager_unlock_deep_sleep();
+
+class DeepSleepLock {
+public:
+    DeepSleepLock() { sleep_manager_lock_deep_sleep(); }
+    ~DeepSleepLock() { sleep_manager_unlock_deep_sleep(); }
+};
+
+/* Suspended, the output is released (the driver pull-down keeps the actuator off) */
+class PwmOut {
+public:
+    PwmOut(PinName pin);
+    ~PwmOut();
+
+    void write(float value);
+    float read();
+    void period(float seconds);
+    void period_ms(int ms);
+    void period_us(int us);
+    void pulsewidth(float seconds);
+    void pulsewidth_ms(int ms);
+    void pulsewidth_us(int us);
+    int read_period_us();
+    void suspend();
+    void resume();
+
+    PwmOut &operator=(float value) { write(value); return *this; }
+    operator float() { return read(); }
+
+private:
+    PinName pin_;
+    float duty_;
+    int periodUs_;
+    bool suspended_;
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int value = 0);
+
+    void write(int value);
+    int read();
+    int is_connected() { return pin_ != NC; }
+
+    DigitalOut &operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    PinName pin_;
+};
+
+/*
+ *  UART with the Mbed TX buffer (256 bytes): write() returns as soon as the
+ *  data fits in the buffer and sleeps while it is full. The bytes go to the
+ *  SIM_SERIAL_OUT file.
+ */
+class BufferedSerial {
+public:
+    BufferedSerial(PinName tx, PinName rx, int baud = 9600);
+    ~BufferedSerial();
+
+    ssize_t write(const void *buffer, size_t length);
+    void set_baud(int baud);
+    void set_blocking(bool blocking) { (void)blocking; }
+    int enable_input(bool enabled);
+
+private:
+    void transmitted();
+
+    PinName tx_;
+    int64_t charTime_;          // ns per character (10 bits)
+    int64_t idleAt_;            // end of the transmission of the buffered bytes
+    bool input_;                // RX interrupt enabled: deep sleep locked
+    int txDone_;                // timer event at idleAt_, 0 when the UART is idle
+};
+
+/*
+ *  While the pin is an input, writes only update the output latch, which is
+ *  driven again by output()
+ */
+class DigitalInOut {
+public:
+    DigitalInOut(PinName pin) : DigitalInOut(pin, PIN_INPUT, PullNone, 0) {}
+    DigitalInOut(PinName pin, PinDirection direction, PinMode mode, int value);
+
+    void write(int value);
+    int read();
+    void output();
+    void input();
+    void mode(PinMode pull) { (void)pull; }
+    int is_connected() { return pin_ != NC; }
+
+    DigitalInOut &operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    PinName pin_;
+    bool output_;
+    int latch_;
+};
+
+/*
+ *  Edge interrupt. BUTTON1 (active low) is pressed at the SIM_BUTTON times
+ *  and released 100 ms later.
+ */
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : InterruptIn(pin, PullNone) {}
+    InterruptIn(PinName pin, PinMode mode);
+
+    void rise(Callback<void()> func) { rise_ = func; }
+    void fall(Callback<void()> func) { fall_ = func; }
+    void mode(PinMode pull) { (void)pull; }
+    int read();
+
+    operator int() { return read(); }
+
+private:
+    InterruptIn(const InterruptIn &) = delete;
+    InterruptIn &operator=(const InterruptIn &) = delete;
+
+    void edge(int level);
+
+    PinName pin_;
+    Callback<void()> rise_;
+    Callback<void()> fall_;
+};
+
+class Timer {
+public:
+    typedef std::chrono::microseconds duration;
+
+    Timer() : Timer(true) {}
+    ~Timer() { stop(); }
+
+    void start();
+    void stop();
+    void reset();
+    duration elapsed_time();
+
+protected:
+    explicit Timer(bool lockDeepSleep) : lockDeepSleep_(lockDeepSleep), running_(false), started_(0), accumulated_(0) {}
+
+private:
+    bool lockDeepSleep_;
+    bool running_;
+    int64_t started_;
+    int64_t accumulated_;
+};
+
+class LowPowerTimer : public Timer {
+public:
+    LowPowerTimer() : Timer(false) {}
+};
+
+class Ticker {
+public:
+    Ticker() : Ticker(true) {}
+    ~Ticker() { detach(); }
+
+    void attach(Callback<void()> func, std::chrono::microseconds t);
+    void detach();
+
+protected:
+    explicit Ticker(bool lockDeepSleep) : id_(0), lockDeepSleep_(lockDeepSleep) {}
+
+    void attached(int id);      // id of the timer event, locks deep sleep
+
+    int id_;
+    bool lockDeepSleep_;
+};
+
+class Timeout : public Ticker {
+public:
+    Timeout() : Ticker(true) {}
+
+    void attach(Callback<void()> func, std::chrono::microseconds t);
+
+protected:
+    explicit Timeout(bool lockDeepSleep) : Ticker(lockDeepSleep) {}
+};
+
+class LowPowerTicker : public Ticker {
+public:
+    LowPowerTicker() : Ticker(false) {}
+};
+
+class LowPowerTimeout : public Timeout {
+public:
+    LowPowerTimeout() : Timeout(false) {}
+};
+
+} // namespace mbed
+
+void wait_us(int us);
+
+/*
+ *  CPU statistics (platform.cpu-stats-enabled), from the simulated clock
+ */
+typedef uint64_t us_timestamp_t;
+
+typedef struct {
+    us_timestamp_t uptime;
+    us_timestamp_t idle_time;
+    us_timestamp_t sleep_time;
+    us_timestamp_t deep_sleep_time;
+} mbed_stats_cpu_t;
+
+void mbed_stats_cpu_get(mbed_stats_cpu_t *stats);
+
+namespace rtos {
+
+namespace Kernel {
+
+struct Clock {
+    typedef std::chrono::milliseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<Clock> time_point;
+    static const bool is_steady = true;
+
+    static time_point now();
+};
+
+} // namespace Kernel
+
+namespace ThisThread {
+
+void sleep_for(Kernel::Clock::duration rel_time);
+void sleep_until(Kernel::Clock::time_point abs_time);
+void yield();
+
+} // namespace ThisThread
+
+class Thread {
+public:
+    Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE,
+           unsigned char *stack_mem = nullptr, const char *name = nullptr);
+
+    osStatus start(mbed::Callback<void()> task);
+    osStatus join();
+    osStatus set_priority(osPriority priority);
+    osPriority get_priority() const;
+    const char *get_name() const;
+
+private:
+    sim::Task *task_;
+    osPriority priority_;
+    const char *name_;
+};
+
+class Mutex {
+public:
+    Mutex() : locked_(false) {}
+
+    void lock();
+    bool trylock();
+    void unlock();
+
+private:
+    bool locked_;
+};
+
+class EventFlags {
+public:
+    EventFlags() : flags_(0) {}
+
+    uint32_t set(uint32_t flags);
+    uint32_t clear(uint32_t flags = 0x7FFFFFFF);
+    uint32_t get() const { return flags_; }
+    uint32_t wait_any(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+    uint32_t wait_all(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+
+private:
+    uint32_t wait(uint32_t flags, uint32_t millisec, bool clear, bool all);
+
+    uint32_t flags_;
+};
+
+} // namespace rtos
+
+/*
+ *  Console output is charged to the calling thread at the serial baud rate
+ */
+int sim_console_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#define printf(...) sim_console_printf(__VA_ARGS__)
+
+using namespace mbed;
+using namespace rtos;
+using namespace std;
+
+#endif // HOST_MBED_H
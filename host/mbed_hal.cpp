@@ -0,0 +1,886 @@
+/*
+ * mbed_hal.cpp
+ *
+ *  Host implementation of the Mbed API in mbed.h: the simulated board.
+ *
+ *  Wiring (same as main.cpp):
+ *      A0  external light sensor       D3  artificialLight PWM
+ *      A1  internal light sensor       D5  electrochromicGlass PWM
+ *      A2  humidity sensor             D6  nebulizer PWM
+ *      A3  user light reference        D7..D13  HD44780 RS, RW, EN, D4..D7
+ *      A4  user humidity reference     D2, D4, D14, D15  HD44780 D0..D3 (8 bit interface)
+ *                                      PC_0..PC_3  EN of the panels 1..4 sharing the bus
+ *
+ *  Environment variables:
+ *      SIM_SECONDS             simulated run length (s, default 600)
+ *      SIM_START_HOUR          time of day at reset (default 8)
+ *      SIM_CLOUDINESS          mean cloud cover 0..1 (default 0.2)
+ *      SIM_CLOUD_VARIABILITY   cloud cover random walk (default 0)
+ *      SIM_SENSOR_NOISE        sensor noise std deviation (default 0)
+ *      SIM_SEED                random seed (default 1)
+ *      SIM_USER_LIGHT          A3 knob position (default 0.3)
+ *      SIM_USER_UMIDITY        A4 knob position (default 0.5)
+ *      SIM_BAUD                console baud rate (default 9600)
+ *      SIM_CONSOLE             1 = echo the console output to stdout
+ *      SIM_TRACE               CSV file of the plant trajectory
+ *      SIM_TRACE_PERIOD        trace sample period (s, default 60)
+ *      SIM_SERIAL_OUT          file receiving the bytes written to BufferedSerial
+ *      SIM_BUTTON              BUTTON1 press times (s, comma separated)
+ *      SIM_DEEP_SLEEP_LATENCY_MS   shortest idle interval spent in deep sleep (default 3)
+ *      SIM_POWER_BUDGET        awake time budget (%): exit status 1 when over
+ */
+
+#include "mbed.h"
+#include "sim.h"
+#include "plant.h"
+#include "lcd_panel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+
+#undef printf
+
+namespace {
+
+const sim::sim_time_t PLANT_STEP = 10 * sim::NS_PER_MS;
+
+class Board {
+public:
+    Board()
+        : plant_(plantParams()), pending_(0), serialBytes_(0), serialOut_(nullptr),
+          traceNext_(0), trace_(nullptr)
+    {
+        for (int i = 0; i < PIN_NUMBER; i++) {
+            levels_[i] = 0;
+            duty_[i] = 0.0;
+            dutyIntegral_[i] = 0.0;
+        }
+        levels_[BUTTON1] = 1;   // pull-up, released
+
+        userLight_ = sim::envDouble("SIM_USER_LIGHT", 0.3);
+        userUmidity_ = sim::envDouble("SIM_USER_UMIDITY", 0.5);
+        charTime_ = (sim::sim_time_t)(10.0 * sim::NS_PER_S / sim::envDouble("SIM_BAUD", 9600));
+        echo_ = sim::envDouble("SIM_CONSOLE", 0) != 0;
+
+        const char *serial = getenv("SIM_SERIAL_OUT");
+        if (serial != nullptr && *serial != '\0') {
+            serialOut_ = fopen(serial, "wb");
+        }
+
+        const char *trace = getenv("SIM_TRACE");
+        if (trace != nullptr && *trace != '\0') {
+            trace_ = fopen(trace, "w");
+            tracePeriod_ = (sim::sim_time_t)(sim::envDouble("SIM_TRACE_PERIOD", 60.0) * sim::NS_PER_S);
+            if (trace_ != nullptr) {
+                fprintf(trace_, "time_s,hour,external,internal,humidity,artificial,glass,nebulizer\n");
+            }
+        }
+
+        sim::onAdvance([this](sim::sim_time_t from, sim::sim_time_t to) { advance(from, to); });
+        sim::onReport([this](FILE *out) { report(out); });
+    }
+
+    float analogRead(PinName pin)
+    {
+        double value;
+
+        switch (pin) {
+            case A0: value = plant_.readExternalLight(); break;
+            case A1: value = plant_.readInternalLight(); break;
+            case A2: value = plant_.readHumidity(); break;
+            case A3: value = userLight_; break;
+            case A4: value = userUmidity_; break;
+            default: value = 0.0; break;
+        }
+
+        // 12 bit converter
+        return (float)std::lround(value * 4095.0);
+    }
+
+    void pwmWrite(PinName pin, float duty)
+    {
+        duty_[pin] = duty;
+    }
+
+    void digitalWrite(PinName pin, int value)
+    {
+        levels_[pin] = value ? 1 : 0;
+
+        int panel = lcdPanel(pin);
+        if (panel >= 0) {
+            panels_[panel].write(HD44780Panel::E_LINE_EN, levels_[pin], sim::now());
+            return;
+        }
+
+        int line = lcdLine(pin);
+        if (line >= 0) {
+            for (int i = 0; i < LCD_PANELS; i++) {
+                panels_[i].write(line, levels_[pin], sim::now());   // shared by every panel
+            }
+        }
+    }
+
+    int digitalRead(PinName pin)
+    {
+        int line = lcdLine(pin);
+        if (line >= 0) {
+            for (int i = 1; i < LCD_PANELS; i++) {
+                if (levels_[LCD_ENABLE[i]]) {
+                    return panels_[i].read(line, sim::now());       // the enabled panel drives the bus
+                }
+            }
+            return panels_[0].read(line, sim::now());
+        }
+
+        return levels_[pin];
+    }
+
+    void serial(const void *data, size_t length)
+    {
+        serialBytes_ += length;
+        if (serialOut_ != nullptr) {
+            fwrite(data, 1, length, serialOut_);
+        }
+    }
+
+    void console(const char *text, int length)
+    {
+        sim::counters().consoleChars += length;
+        if (echo_) {
+            fwrite(text, 1, length, stdout);
+        }
+        sim::consume(length * charTime_);
+    }
+
+private:
+    static GreenhousePlant::Params plantParams()
+    {
+        GreenhousePlant::Params p;
+
+        p.startHour = sim::envDouble("SIM_START_HOUR", p.startHour);
+        p.cloudiness = sim::envDouble("SIM_CLOUDINESS", p.cloudiness);
+        p.cloudVariability = sim::envDouble("SIM_CLOUD_VARIABILITY", p.cloudVariability);
+        p.sensorNoise = sim::envDouble("SIM_SENSOR_NOISE", p.sensorNoise);
+        p.seed = (uint32_t)sim::envDouble("SIM_SEED", p.seed);
+
+        return p;
+    }
+
+    static const int LCD_PANELS = 5;
+    static const PinName LCD_ENABLE[LCD_PANELS];
+
+    static int lcdPanel(PinName pin)
+    {
+        for (int i = 0; i < LCD_PANELS; i++) {
+            if (LCD_ENABLE[i] == pin) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    static int lcdLine(PinName pin)
+    {
+        switch (pin) {
+            case D7:  return HD44780Panel::E_LINE_RS;
+            case D8:  return HD44780Panel::E_LINE_RW;
+            case D2:  return HD44780Panel::E_LINE_DB0;
+            case D4:  return HD44780Panel::E_LINE_DB1;
+            case D14: return HD44780Panel::E_LINE_DB2;
+            case D15: return HD44780Panel::E_LINE_DB3;
+            case D10: return HD44780Panel::E_LINE_DB4;
+            case D11: return HD44780Panel::E_LINE_DB5;
+            case D12: return HD44780Panel::E_LINE_DB6;
+            case D13: return HD44780Panel::E_LINE_DB7;
+            default:  return -1;
+        }
+    }
+
+    GreenhousePlant::Actuators actuators() const
+    {
+        GreenhousePlant::Actuators u;
+
+        u.artificialLight = duty_[D3];
+        u.electrochromicGlass = duty_[D5];
+        u.nebulizer = duty_[D6];
+
+        return u;
+    }
+
+    void advance(sim::sim_time_t from, sim::sim_time_t to)
+    {
+        double dt = (double)(to - from) / sim::NS_PER_S;
+
+        for (int i = 0; i < PIN_NUMBER; i++) {
+            dutyIntegral_[i] += duty_[i] * dt;
+        }
+
+        pending_ += to - from;
+        while (pending_ >= PLANT_STEP) {
+            pending_ -= PLANT_STEP;
+            plant_.step((double)PLANT_STEP / sim::NS_PER_S, actuators());
+
+            if (trace_ != nullptr && to - pending_ >= traceNext_) {
+                traceNext_ += tracePeriod_;
+                fprintf(trace_, "%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", plant_.time(), plant_.hourOfDay(),
+                        plant_.externalLight(), plant_.internalLight(), plant_.humidity(),
+                        duty_[D3], duty_[D5], duty_[D6]);
+            }
+        }
+    }
+
+    void report(FILE *out)
+    {
+        double t = plant_.time();
+
+        fprintf(out, "plant at %05.2f h (%.0f s simulated)\n", plant_.hourOfDay(), t);
+        fprintf(out, "  external light    : %.3f\n", plant_.externalLight());
+        fprintf(out, "  internal light    : %.3f\n", plant_.internalLight());
+        fprintf(out, "  humidity          : %.3f\n", plant_.humidity());
+        fprintf(out, "  mean duty         : artificialLight %.3f  electrochromicGlass %.3f  nebulizer %.3f\n",
+                t > 0 ? dutyIntegral_[D3] / t : 0.0, t > 0 ? dutyIntegral_[D5] / t : 0.0,
+                t > 0 ? dutyIntegral_[D6] / t : 0.0);
+        fprintf(out, "\n");
+        panels_[0].report(out, "D7..D13");
+        for (int i = 1; i < LCD_PANELS; i++) {
+            if (panels_[i].stats().instructions > 0) {
+                char name[24];
+                snprintf(name, sizeof(name), "D7..D13, EN PC_%d", i - 1);
+                panels_[i].report(out, name);
+            }
+        }
+
+        if (serialBytes_ > 0) {
+            fprintf(out, "serial\n");
+            fprintf(out, "  bytes written     : %llu\n", (unsigned long long)serialBytes_);
+        }
+        if (serialOut_ != nullptr) {
+            fclose(serialOut_);
+            serialOut_ = nullptr;
+        }
+
+        if (trace_ != nullptr) {
+            fclose(trace_);
+            trace_ = nullptr;
+        }
+    }
+
+    GreenhousePlant plant_;
+    HD44780Panel panels_[LCD_PANELS];  // panel 0 on D9, the others on the morpho pins
+
+    int levels_[PIN_NUMBER];
+    double duty_[PIN_NUMBER];
+    double dutyIntegral_[PIN_NUMBER];
+    double userLight_;
+    double userUmidity_;
+
+    sim::sim_time_t pending_;
+    sim::sim_time_t charTime_;
+    bool echo_;
+
+    uint64_t serialBytes_;
+    FILE *serialOut_;
+
+    sim::sim_time_t traceNext_;
+    sim::sim_time_t tracePeriod_;
+    FILE *trace_;
+};
+
+const PinName Board::LCD_ENABLE[Board::LCD_PANELS] = { D9, PC_0, PC_1, PC_2, PC_3 };
+
+Board &board()
+{
+    static Board *b = new Board;
+    return *b;
+}
+
+} // namespace
+
+namespace mbed {
+
+/*
+ *  AnalogIn
+ */
+float AnalogIn::read()
+{
+    sim::counters().adcConversions++;
+    sim::consume(sim::COST_ADC_CONVERSION);
+    return board().analogRead(pin_) * (1.0f / 4095.0f);
+}
+
+unsigned short AnalogIn::read_u16()
+{
+    sim::counters().adcConversions++;
+    sim::consume(sim::COST_ADC_CONVERSION);
+
+    // 12 bit result left aligned to 16 bits, as on the STM32 targets
+    unsigned short raw = (unsigned short)board().analogRead(pin_);
+    return (unsigned short)((raw << 4) | (raw >> 8));
+}
+
+/*
+ *  Sleep manager
+ */
+void sleep_manager_lock_deep_sleep()
+{
+    sim::lockDeepSleep();
+}
+
+void sleep_manager_unlock_deep_sleep()
+{
+    sim::unlockDeepSleep();
+}
+
+/*
+ *  PwmOut
+ */
+PwmOut::PwmOut(PinName pin)
+    : pin_(pin), duty_(0.0f), periodUs_(20000), suspended_(false) {
+    sim::lockDeepSleep();       // the PWM timer stops in deep sleep
+    board().pwmWrite(pin_, 0.0f);
+}
+
+PwmOut::~PwmOut()
+{
+    suspend();
+}
+
+void PwmOut::suspend()
+{
+    if (!suspended_) {
+        sim::consume(sim::COST_PWM_WRITE);
+        suspended_ = true;
+        board().pwmWrite(pin_, 0.0f);
+        sim::unlockDeepSleep();
+    }
+}
+
+void PwmOut::resume()
+{
+    if (suspended_) {
+        sim::lockDeepSleep();
+        suspended_ = false;
+        write(duty_);           // the duty before suspend()
+    }
+}
+
+void PwmOut::write(float value)
+{
+    if (value < 0.0f) {
+        value = 0.0f;
+    } else if (value > 1.0f) {
+        value = 1.0f;
+    }
+
+    sim::counters().pwmWrites++;
+    sim::consume(sim::COST_PWM_WRITE);
+    duty_ = value;
+    if (!suspended_) {
+        board().pwmWrite(pin_, duty_);
+    }
+}
+
+float PwmOut::read()
+{
+    return duty_;
+}
+
+void PwmOut::period(float seconds)
+{
+    period_us((int)(seconds * 1000000.0f));
+}
+
+void PwmOut::period_ms(int ms)
+{
+    period_us(ms * 1000);
+}
+
+void PwmOut::period_us(int us)
+{
+    sim::consume(sim::COST_PWM_WRITE);
+    periodUs_ = us > 0 ? us : 1;
+}
+
+void PwmOut::pulsewidth(float seconds)
+{
+    pulsewidth_us((int)(seconds * 1000000.0f));
+}
+
+void PwmOut::pulsewidth_ms(int ms)
+{
+    pulsewidth_us(ms * 1000);
+}
+
+void PwmOut::pulsewidth_us(int us)
+{
+    write((float)us / (float)periodUs_);
+}
+
+int PwmOut::read_period_us()
+{
+    return periodUs_;
+}
+
+/*
+ *  DigitalOut
+ */
+DigitalOut::DigitalOut(PinName pin, int value)
+    : pin_(pin) {
+    if (pin_ != NC) {
+        board().digitalWrite(pin_, value);
+    }
+}
+
+void DigitalOut::write(int value)
+{
+    sim::counters().gpioWrites++;
+    if (pin_ != NC) {
+        board().digitalWrite(pin_, value);
+    }
+    sim::consume(sim::COST_GPIO_WRITE);
+}
+
+int DigitalOut::read()
+{
+    sim::counters().gpioReads++;
+    sim::consume(sim::COST_GPIO_READ);
+    return pin_ != NC ? board().digitalRead(pin_) : 0;
+}
+
+/*
+ *  BufferedSerial
+ */
+const size_t SERIAL_TXBUF_SIZE = 256;
+
+BufferedSerial::BufferedSerial(PinName tx, PinName rx, int baud)
+    : tx_(tx), idleAt_(0), input_(false), txDone_(0) {
+    set_baud(baud);
+    enable_input(rx != NC);     // TX only (rx NC): no RX interrupt
+}
+
+BufferedSerial::~BufferedSerial()
+{
+    enable_input(false);
+    if (txDone_ != 0) {
+        sim::removeTimer(txDone_);
+        transmitted();
+    }
+}
+
+int BufferedSerial::enable_input(bool enabled)
+{
+    if (enabled && !input_) {
+        sim::lockDeepSleep();   // a received character must find the UART clocked
+    } else if (!enabled && input_) {
+        sim::unlockDeepSleep();
+    }
+    input_ = enabled;
+
+    return 0;
+}
+
+void BufferedSerial::transmitted()
+{
+    txDone_ = 0;
+    sim::unlockDeepSleep();
+}
+
+void BufferedSerial::set_baud(int baud)
+{
+    charTime_ = 10 * sim::NS_PER_S / baud;
+}
+
+ssize_t BufferedSerial::write(const void *buffer, size_t length)
+{
+    const uint8_t *data = (const uint8_t *)buffer;
+    size_t written = 0;
+
+    while (written < length) {
+        sim::sim_time_t now = sim::now();
+        if (idleAt_ < now) {
+            idleAt_ = now;
+        }
+
+        /* Room left in the TX buffer, else wait for the UART to drain it */
+        size_t queued = (size_t)((idleAt_ - now + charTime_ - 1) / charTime_);
+        if (queued >= SERIAL_TXBUF_SIZE) {
+            sim::sleepUntil(idleAt_ - (sim::sim_time_t)(SERIAL_TXBUF_SIZE - 1) * charTime_);
+            continue;
+        }
+
+        size_t chunk = std::min(length - written, SERIAL_TXBUF_SIZE - queued);
+        board().serial(data + written, chunk);
+        idleAt_ += (sim::sim_time_t)chunk * charTime_;
+        written += chunk;
+
+        /* TX interrupt until the buffer is drained: deep sleep locked */
+        if (txDone_ != 0) {
+            sim::removeTimer(txDone_);
+        } else {
+            sim::lockDeepSleep();
+        }
+        txDone_ = sim::addTimer(idleAt_, 0, [this] { transmitted(); });
+        sim::consume(chunk * sim::COST_GPIO_WRITE);     // copy into the buffer
+    }
+
+    return (ssize_t)length;
+}
+
+/*
+ *  DigitalInOut
+ */
+DigitalInOut::DigitalInOut(PinName pin, PinDirection direction, PinMode mode, int value)
+    : pin_(pin), output_(direction == PIN_OUTPUT), latch_(value ? 1 : 0) {
+    (void)mode;
+    if (pin_ != NC && output_) {
+        board().digitalWrite(pin_, latch_);
+    }
+}
+
+void DigitalInOut::write(int value)
+{
+    sim::counters().gpioWrites++;
+    latch_ = value ? 1 : 0;
+    if (pin_ != NC && output_) {
+        board().digitalWrite(pin_, latch_);
+    }
+    sim::consume(sim::COST_GPIO_WRITE);
+}
+
+int DigitalInOut::read()
+{
+    sim::counters().gpioReads++;
+    sim::consume(sim::COST_GPIO_READ);
+    return pin_ != NC ? board().digitalRead(pin_) : 0;
+}
+
+void DigitalInOut::output()
+{
+    output_ = true;
+    if (pin_ != NC) {
+        board().digitalWrite(pin_, latch_);
+    }
+    sim::consume(sim::COST_GPIO_WRITE);
+}
+
+void DigitalInOut::input()
+{
+    output_ = false;
+    sim::consume(sim::COST_GPIO_WRITE);
+}
+
+/*
+ *  InterruptIn
+ */
+const sim::sim_time_t BUTTON_PRESS = 100 * sim::NS_PER_MS;
+
+InterruptIn::InterruptIn(PinName pin, PinMode mode)
+    : pin_(pin) {
+    (void)mode;
+
+    const char *presses = getenv("SIM_BUTTON");
+    if (pin_ != BUTTON1 || presses == nullptr) {
+        return;
+    }
+
+    char *end;
+    for (const char *p = presses; *p != '\0'; p = *end == ',' ? end + 1 : end) {
+        double seconds = strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+
+        sim::sim_time_t when = (sim::sim_time_t)(seconds * sim::NS_PER_S);
+        sim::addTimer(when, 0, [this] { edge(0); });
+        sim::addTimer(when + BUTTON_PRESS, 0, [this] { edge(1); });
+    }
+}
+
+int InterruptIn::read()
+{
+    sim::counters().gpioReads++;
+    sim::consume(sim::COST_GPIO_READ);
+    return pin_ != NC ? board().digitalRead(pin_) : 0;
+}
+
+void InterruptIn::edge(int level)
+{
+    if (board().digitalRead(pin_) == level) {
+        return;
+    }
+
+    board().digitalWrite(pin_, level);
+    if (level && rise_) {
+        rise_();
+    } else if (!level && fall_) {
+        fall_();
+    }
+}
+
+/*
+ *  Timer
+ */
+void Timer::start()
+{
+    if (!running_) {
+        started_ = sim::now();
+        running_ = true;
+        if (lockDeepSleep_) {
+            sim::lockDeepSleep();       // the microsecond ticker stops in deep sleep
+        }
+    }
+}
+
+void Timer::stop()
+{
+    if (running_) {
+        accumulated_ += sim::now() - started_;
+        running_ = false;
+        if (lockDeepSleep_) {
+            sim::unlockDeepSleep();
+        }
+    }
+}
+
+void Timer::reset()
+{
+    accumulated_ = 0;
+    started_ = sim::now();
+}
+
+Timer::duration Timer::elapsed_time()
+{
+    sim::consume(sim::COST_TIMER_READ);
+
+    int64_t elapsed = accumulated_;
+    if (running_) {
+        elapsed += sim::now() - started_;
+    }
+
+    return duration(elapsed / sim::NS_PER_US);
+}
+
+/*
+ *  Ticker / Timeout
+ */
+void Ticker::attach(Callback<void()> func, std::chrono::microseconds t)
+{
+    sim::sim_time_t period = (sim::sim_time_t)t.count() * sim::NS_PER_US;
+
+    detach();
+    attached(sim::addTimer(sim::now() + period, period, [func] { func(); }));
+}
+
+void Ticker::detach()
+{
+    if (id_ != 0) {
+        sim::removeTimer(id_);
+        id_ = 0;
+        if (lockDeepSleep_) {
+            sim::unlockDeepSleep();
+        }
+    }
+}
+
+void Ticker::attached(int id)
+{
+    id_ = id;
+    if (lockDeepSleep_) {
+        sim::lockDeepSleep();
+    }
+}
+
+void Timeout::attach(Callback<void()> func, std::chrono::microseconds t)
+{
+    detach();
+    attached(sim::addTimer(sim::now() + (sim::sim_time_t)t.count() * sim::NS_PER_US, 0, [this, func] {
+        id_ = 0;
+        if (lockDeepSleep_) {
+            sim::unlockDeepSleep();
+        }
+        func();
+    }));
+}
+
+} // namespace mbed
+
+void wait_us(int us)
+{
+    sim::consume((sim::sim_time_t)us * sim::NS_PER_US);
+}
+
+void mbed_stats_cpu_get(mbed_stats_cpu_t *stats)
+{
+    stats->uptime = sim::now() / sim::NS_PER_US;
+    stats->idle_time = sim::idleTime() / sim::NS_PER_US;
+    stats->sleep_time = sim::sleepTime() / sim::NS_PER_US;
+    stats->deep_sleep_time = sim::deepSleepTime() / sim::NS_PER_US;
+}
+
+namespace rtos {
+
+Kernel::Clock::time_point Kernel::Clock::now()
+{
+    return time_point(duration(sim::now() / sim::NS_PER_MS));
+}
+
+void ThisThread::sleep_for(Kernel::Clock::duration rel_time)
+{
+    sim::sleepUntil(sim::now() + (sim::sim_time_t)rel_time.count() * sim::NS_PER_MS);
+}
+
+void ThisThread::sleep_until(Kernel::Clock::time_point abs_time)
+{
+    sim::sleepUntil((sim::sim_time_t)abs_time.time_since_epoch().count() * sim::NS_PER_MS);
+}
+
+void ThisThread::yield()
+{
+    sim::yield();
+}
+
+Thread::Thread(osPriority priority, uint32_t stack_size, unsigned char *stack_mem, const char *name)
+    : task_(nullptr), priority_(priority), name_(name) {
+    (void)stack_size;
+    (void)stack_mem;
+}
+
+osStatus Thread::start(mbed::Callback<void()> task)
+{
+    task_ = sim::spawn([task] { task(); }, priority_, name_);
+    return osOK;
+}
+
+osStatus Thread::join()
+{
+    if (task_ != nullptr) {
+        sim::join(task_);
+    }
+    return osOK;
+}
+
+osStatus Thread::set_priority(osPriority priority)
+{
+    priority_ = priority;
+    if (task_ != nullptr) {
+        sim::setPriority(task_, priority);
+    }
+    return osOK;
+}
+
+osPriority Thread::get_priority() const
+{
+    return priority_;
+}
+
+const char *Thread::get_name() const
+{
+    return task_ != nullptr ? sim::name(task_) : name_;
+}
+
+/*
+ *  Mutex and EventFlags: blocking is a sim::waitUntil on the object state,
+ *  every call is charged as a kernel call
+ */
+void Mutex::lock()
+{
+    sim::consume(sim::COST_KERNEL_CALL);
+    sim::waitUntil([this] { return !locked_; });
+    locked_ = true;
+}
+
+bool Mutex::trylock()
+{
+    sim::consume(sim::COST_KERNEL_CALL);
+    if (locked_) {
+        return false;
+    }
+    locked_ = true;
+    return true;
+}
+
+void Mutex::unlock()
+{
+    locked_ = false;
+    sim::consume(sim::COST_KERNEL_CALL);
+}
+
+uint32_t EventFlags::set(uint32_t flags)
+{
+    flags_ |= flags;
+    uint32_t result = flags_;
+
+    if (sim::inIsr()) {
+        return result;
+    }
+    sim::consume(sim::COST_KERNEL_CALL);
+    sim::reschedule();
+
+    return result;
+}
+
+uint32_t EventFlags::clear(uint32_t flags)
+{
+    uint32_t result = flags_;
+
+    flags_ &= ~flags;
+    return result;
+}
+
+uint32_t EventFlags::wait_any(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, millisec, clear, false);
+}
+
+uint32_t EventFlags::wait_all(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, millisec, clear, true);
+}
+
+uint32_t EventFlags::wait(uint32_t flags, uint32_t millisec, bool clear, bool all)
+{
+    sim::sim_time_t deadline = -1;
+
+    if (millisec != osWaitForever) {
+        deadline = sim::now() + (sim::sim_time_t)millisec * sim::NS_PER_MS;
+    }
+
+    sim::consume(sim::COST_KERNEL_CALL);
+    bool ready = sim::waitUntil([this, flags, all] {
+        return all ? (flags_ & flags) == flags : (flags_ & flags) != 0;
+    }, deadline);
+
+    if (!ready) {
+        return osFlagsErrorTimeout;
+    }
+
+    uint32_t result = flags_;
+    if (clear) {
+        flags_ &= ~flags;
+    }
+
+    return result;
+}
+
+} // namespace rtos
+
+int sim_console_printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length > (int)sizeof(buffer) - 1) {
+        length = sizeof(buffer) - 1;
+    }
+    if (length > 0) {
+        board().console(buffer, length);
+    }
+
+    return length;
+}
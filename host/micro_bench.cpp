@@ -0,0 +1,124 @@
+/*
+ *  micro_bench.cpp
+ *
+ *  Host driver of the microbenchmark suite (benchmarks.cpp). The LCD runs
+ *  on mocked callbacks that only count: invocations and requested delay
+ *  time are exact and machine independent, cycles are steady clock
+ *  nanoseconds (cycle_counter.h).
+ *
+ *  The LCD cases run on "pin" (per-pin callbacks, fixed delays, the
+ *  original driver setup), "bus_bf" (bus callback and busy flag, as in
+ *  main.cpp; the mocked LCD is never busy), "bus8_bf" (same on the 8 bit
+ *  interface) and "template_bf" / "template8_bf" (the HD44780Driver
+ *  template on an inline pin policy, busy flag, 4 and 8 bit; every pin
+ *  write is counted as a callback).
+ *
+ *      micro_bench > micro_bench.csv
+ */
+
+#include "benchmarks.h"
+#include "HD44780.h"
+#include "hd44780_driver.h"
+
+#include <cstdio>
+
+namespace {
+
+uint64_t callbackCount = 0;
+uint64_t delayUsCount = 0;
+
+void mockPin(int state)                           { (void)state; callbackCount++; }
+void mockBus(int rs, int rw, int en, int data)    { (void)rs; (void)rw; (void)en; (void)data; callbackCount++; }
+void mockDelayMs(int ms)                          { callbackCount++; delayUsCount += (uint64_t)ms * 1000; }
+void mockDelayUs(int us)                          { callbackCount++; delayUsCount += (uint64_t)us; }
+void mockDataInput(int state)                     { (void)state; callbackCount++; }
+int mockReadDataLine7(void)                       { callbackCount++; return 0; }    // never busy
+
+uint64_t callbacks(void) { return callbackCount; }
+uint64_t delayUs(void)   { return delayUsCount; }
+
+const bench_probe_t PROBE = { callbacks, delayUs };
+
+/* Inline pin policy of the template: counts the lines that change, like HD44780Pins */
+template <bool EightBit>
+struct MockPins {
+    static const int DATA_LINES = EightBit ? 8 : 4;
+
+    static void lines(int rs, int rw, unsigned char data)
+    {
+        write(0, rs);
+        write(1, rw);
+        for (int i = 0; i < DATA_LINES; i++) {
+            write(2 + i, (data >> i) & 1);
+        }
+    }
+
+    static void readMode(int rw)
+    {
+        write(0, 0);
+        write(1, rw);
+    }
+
+    static void enable(int level)                   { (void)level; callbackCount++; }
+    static constexpr bool eightBit()                { return EightBit; }
+    static constexpr bool busyFlag()                { return true; }
+    static void dataInput(bool input)               { (void)input; callbackCount++; }
+    static int busy()                               { callbackCount++; return 0; }
+    static void delayMs(int ms)                     { callbackCount++; delayUsCount += (uint64_t)ms * 1000; }
+    static void delayUs(int us)                     { callbackCount++; delayUsCount += (uint64_t)us; }
+
+    static void write(int line, int level)
+    {
+        if (levels[line] != level) {
+            levels[line] = level;
+            callbackCount++;
+        }
+    }
+
+    static int levels[10];
+};
+
+template <bool EightBit>
+int MockPins<EightBit>::levels[10] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+HD44780Driver<MockPins<false>, Lcd16x2> templateLcd;
+HD44780Driver<MockPins<true>, Lcd16x2> templateLcd8;
+
+void registerPins(void)
+{
+    for (int type = E_CALLBACK_RS; type <= E_CALLBACK_DATA7; type++) {
+        register_callback(mockPin, (E_CALLBACK_TYPE)type);
+    }
+    register_callback(mockDelayMs, E_DELAY);
+}
+
+} // namespace
+
+int main()
+{
+    registerPins();
+    init_LCD();
+    run_benchmarks(stdout, &PROBE, "pin");
+
+    unregister_callbacks();
+    register_bus_callback(mockBus);
+    register_callback(mockDelayMs, E_DELAY);
+    register_read_callback(mockReadDataLine7, mockDataInput, mockDelayUs);
+    init_LCD();
+    run_lcd_benchmarks(stdout, &PROBE, "bus_bf");
+
+    unregister_callbacks();
+    register_bus8_callback(mockBus);
+    register_callback(mockDelayMs, E_DELAY);
+    register_read_callback(mockReadDataLine7, mockDataInput, mockDelayUs);
+    init_LCD();
+    run_lcd_benchmarks(stdout, &PROBE, "bus8_bf");
+
+    templateLcd.init();
+    run_driver_benchmarks(stdout, &PROBE, "template_bf", templateLcd);
+
+    templateLcd8.init();
+    run_driver_benchmarks(stdout, &PROBE, "template8_bf", templateLcd8);
+
+    return 0;
+}
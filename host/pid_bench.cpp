@@ -0,0 +1,210 @@
+/*
+ * pid_bench.cpp
+ *
+ *  Compares PID::calculate (float reference) with PIDEngine<float>,
+ *  PIDEngine<Q15> and PIDEngine<Q31>: host time and cycles per call, and
+ *  output error against the reference on the same input sequence.
+ *
+ *  The input is a noisy measured value oscillating around the setpoint,
+ *  fed open loop so every engine sees exactly the same samples. Errors are
+ *  given on the raw output and on the actuator value (clamped to 0..1, as
+ *  PwmOut::write does).
+ *
+ *  Host cycles are only a relative indication; the Cortex-M numbers come
+ *  from the DWT cycle counter on target.
+ */
+
+#include "mbed.h"
+#include "pid.h"
+#include "pid_engine.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#undef printf
+
+namespace {
+
+constexpr float DT = 0.01f;             // 100 Hz, as update_pid
+const float SETPOINT = 0.625f;          // DAYLIGHT_REFERENCE
+const int SAMPLES = 20000;
+const int REPEAT = 50;
+
+struct Case {
+    const char *name;
+    PIDGains gains;
+};
+
+constexpr Case CASES[] = {
+    { "pid1 (1, 0, 0)",   PIDGains(1.0f, 0.0f, 0.0f) },
+    { "pid2 (1, 0, 0.5)", PIDGains(1.0f, 0.0f, 0.5f) },
+    { "pi (0.5, 2, 0)",   PIDGains(0.5f, 2.0f, 0.0f) },
+};
+
+constexpr bool casesFit(unsigned i = 0)
+{
+    return i == sizeof(CASES) / sizeof(CASES[0]) || (pid_engine_gains_fit(CASES[i].gains, DT) && casesFit(i + 1));
+}
+static_assert(casesFit(), "PIDEngine coefficients out of range");
+
+// Coefficients are computed by the compiler: Kd / dt = 50 in Q7.24 (int32 with 7 integer bits),
+// within the float rounding of dt = 0.01f
+constexpr PIDEngine<Q15>::Coefficients PID2_Q15(PIDGains(1.0f, 0.0f, 0.5f), DT);
+static_assert(PID2_Q15.a2 > (50 << 24) - 32 && PID2_Q15.a2 < (50 << 24) + 32, "constexpr Q15 coefficients");
+
+struct Result {
+    double nsPerCall;
+    double cyclesPerCall;
+    double maxError;
+    double rmsError;
+    double maxActuatorError;
+};
+
+std::vector<float> makeInput()
+{
+    std::vector<float> input(SAMPLES);
+    uint32_t lcg = 12345;
+
+    for (int n = 0; n < SAMPLES; n++) {
+        lcg = lcg * 1664525u + 1013904223u;
+        float noise = ((lcg >> 8) / 16777216.0f - 0.5f) * 0.01f;
+        input[n] = SETPOINT + 0.2f * std::sin(2.0f * 3.14159265f * n / 500.0f) + noise;
+    }
+
+    return input;
+}
+
+float clamp01(float value)
+{
+    return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+inline uint64_t cycles()
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+template <typename V>
+inline void keep(const V &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+inline float asFloat(float value) { return value; }
+inline float asFloat(Q15 value) { return value.toFloat(); }
+inline float asFloat(Q31 value) { return value.toFloat(); }
+
+/*
+ * Runs step(n) over the input REPEAT times for the timing, then once more
+ * to collect the outputs. reset() is called before every pass.
+ */
+template <typename Reset, typename Step>
+Result measure(const std::vector<float> &reference, Reset reset, Step step)
+{
+    Result r = {};
+    std::vector<float> output(SAMPLES);
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    for (int k = 0; k < REPEAT; k++) {
+        reset();
+        for (int n = 0; n < SAMPLES; n++) {
+            keep(step(n));
+        }
+    }
+    uint64_t c1 = cycles();
+    auto t1 = std::chrono::steady_clock::now();
+
+    double calls = (double)SAMPLES * REPEAT;
+    r.nsPerCall = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+    r.cyclesPerCall = (double)(c1 - c0) / calls;
+
+    reset();
+    for (int n = 0; n < SAMPLES; n++) {
+        output[n] = asFloat(step(n));
+    }
+
+    double sum = 0.0;
+    for (int n = 0; n < SAMPLES; n++) {
+        double e = std::fabs((double)output[n] - reference[n]);
+        double ea = std::fabs((double)clamp01(output[n]) - clamp01(reference[n]));
+
+        sum += e * e;
+        r.maxError = std::max(r.maxError, e);
+        r.maxActuatorError = std::max(r.maxActuatorError, ea);
+    }
+    r.rmsError = std::sqrt(sum / SAMPLES);
+
+    return r;
+}
+
+void print(const char *engine, const Result &r)
+{
+    printf("  %-18s %10.2f %10.1f %12.3e %12.3e %12.3e\n", engine, r.nsPerCall, r.cyclesPerCall,
+           r.maxError, r.rmsError, r.maxActuatorError);
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<float> input = makeInput();
+    std::vector<Q15> input15;
+    std::vector<Q31> input31;
+    const Q15 setpoint15 = Q15::fromFloat(SETPOINT);
+    const Q31 setpoint31 = Q31::fromFloat(SETPOINT);
+
+    for (float x : input) {
+        input15.push_back(Q15::fromFloat(x));
+        input31.push_back(Q31::fromFloat(x));
+    }
+
+    printf("PID engines, dt = %.3f s, %d samples x %d\n", DT, SAMPLES, REPEAT);
+
+    for (const Case &c : CASES) {
+        std::vector<float> reference(SAMPLES);
+        {
+            PID pid(c.gains.kp, c.gains.ki, c.gains.kd);
+            for (int n = 0; n < SAMPLES; n++) {
+                reference[n] = pid.calculate(SETPOINT, input[n], DT);
+            }
+        }
+
+        printf("\n%s\n", c.name);
+        printf("  %-18s %10s %10s %12s %12s %12s\n", "engine", "ns/call", "cyc/call", "max err", "rms err",
+               "max act err");
+
+        PID pid(c.gains.kp, c.gains.ki, c.gains.kd);
+        print("PID (reference)", measure(reference,
+            [&] { pid = PID(c.gains.kp, c.gains.ki, c.gains.kd); },
+            [&](int n) { return pid.calculate(SETPOINT, input[n], DT); }));
+
+        PIDEngine<float> pidFloat(PIDEngine<float>::Coefficients(c.gains, DT));
+        print("PIDEngine<float>", measure(reference,
+            [&] { pidFloat.reset(); },
+            [&](int n) { return pidFloat.calculate(SETPOINT, input[n]); }));
+
+        PIDEngine<Q15> pid15(PIDEngine<Q15>::Coefficients(c.gains, DT));
+        print("PIDEngine<Q15>", measure(reference,
+            [&] { pid15.reset(); },
+            [&](int n) { return pid15.calculate(setpoint15, input15[n]); }));
+
+        PIDEngine<Q31> pid31(PIDEngine<Q31>::Coefficients(c.gains, DT));
+        print("PIDEngine<Q31>", measure(reference,
+            [&] { pid31.reset(); },
+            [&](int n) { return pid31.calculate(setpoint31, input31[n]); }));
+    }
+
+    return 0;
+}
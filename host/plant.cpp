@@ -0,0 +1,121 @@
+/*
+ * plant.cpp
+ *
+ *  Greenhouse light and humidity model (see plant.h)
+ */
+
+#include "plant.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double MAX_STEP = 0.05;   // integration step [s]
+
+double clamp01(double value)
+{
+    return std::min(1.0, std::max(0.0, value));
+}
+
+} // namespace
+
+GreenhousePlant::GreenhousePlant()
+    : GreenhousePlant(Params()) {
+}
+
+GreenhousePlant::GreenhousePlant(const Params &params)
+    : params_(params), rng_(params.seed), gauss_(0.0, 1.0), time_(0.0), cloud_(params.cloudiness) {
+    external_ = params_.peakLight * sunFactor() * (1.0 - 0.75 * cloud_);
+    internal_ = external_ * params_.glassTransmission;
+    humidity_ = ambientHumidity();
+}
+
+double GreenhousePlant::hourOfDay() const
+{
+    return std::fmod(params_.startHour + time_ / 3600.0, 24.0);
+}
+
+double GreenhousePlant::sunFactor() const
+{
+    double hour = hourOfDay();
+
+    if (hour <= params_.sunrise || hour >= params_.sunset) {
+        return 0.0;
+    }
+
+    return std::sin(PI * (hour - params_.sunrise) / (params_.sunset - params_.sunrise));
+}
+
+double GreenhousePlant::ambientHumidity() const
+{
+    double sun = sunFactor();
+
+    if (sun <= 0.0) {
+        return params_.humidityNight;
+    }
+
+    return params_.humidityDay - params_.humidityDrop * sun;
+}
+
+void GreenhousePlant::step(double dt, const Actuators &u)
+{
+    double artificial = clamp01(u.artificialLight);
+    double glass = clamp01(u.electrochromicGlass);
+    double nebulizer = clamp01(u.nebulizer);
+
+    while (dt > 0.0) {
+        double h = std::min(dt, MAX_STEP);
+        dt -= h;
+        time_ += h;
+
+        /* Cloud cover: mean-reverting random walk */
+        if (params_.cloudVariability > 0.0) {
+            cloud_ += (params_.cloudiness - cloud_) * h / params_.cloudTau
+                    + params_.cloudVariability * std::sqrt(h / params_.cloudTau) * gauss_(rng_);
+            cloud_ = clamp01(cloud_);
+        }
+
+        /* Light: instantaneous outside, first order lag inside */
+        external_ = params_.peakLight * sunFactor() * (1.0 - 0.75 * cloud_);
+
+        double transmission = params_.glassTransmission
+                            + (params_.glassTinted - params_.glassTransmission) * glass;
+        double target = clamp01(external_ * transmission + params_.lampGain * artificial);
+        internal_ += (target - internal_) * (1.0 - std::exp(-h / params_.lightTau));
+
+        /* Humidity: exchange with the outside air plus nebulizer */
+        double rate = (ambientHumidity() - humidity_) / params_.humidityTau
+                    + params_.nebulizerGain * nebulizer * (1.0 - humidity_);
+        humidity_ += rate * h;
+        if (params_.humidityDisturbance > 0.0) {
+            humidity_ += params_.humidityDisturbance * std::sqrt(h / params_.humidityTau) * gauss_(rng_);
+        }
+        humidity_ = clamp01(humidity_);
+    }
+}
+
+double GreenhousePlant::sensor(double value)
+{
+    if (params_.sensorNoise > 0.0) {
+        value += params_.sensorNoise * gauss_(rng_);
+    }
+
+    return clamp01(value);
+}
+
+double GreenhousePlant::readExternalLight()
+{
+    return sensor(external_);
+}
+
+double GreenhousePlant::readInternalLight()
+{
+    return sensor(internal_);
+}
+
+double GreenhousePlant::readHumidity()
+{
+    return sensor(humidity_);
+}
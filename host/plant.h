@@ -0,0 +1,85 @@
+/*
+ * plant.h
+ *
+ *  Greenhouse light and humidity model used by the host build.
+ *
+ *  All quantities are normalized like the AnalogIn readings of the real
+ *  sensors (0.0 - 1.0). The model has no global state, so several plants
+ *  can be simulated side by side (one per thread).
+ */
+
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <cstdint>
+#include <random>
+
+class GreenhousePlant {
+public:
+    struct Params {
+        double startHour          = 8.0;    // time of day at t = 0 [h]
+        double sunrise            = 6.0;    // [h]
+        double sunset             = 20.0;   // [h]
+        double peakLight          = 1.0;    // clear-sky external light at noon
+        double cloudiness         = 0.2;    // mean cloud cover (0 = clear, 1 = overcast)
+        double cloudVariability   = 0.0;    // cloud cover random walk intensity
+        double cloudTau           = 600.0;  // cloud cover correlation time [s]
+
+        double glassTransmission  = 0.9;    // electrochromic glass, duty 0
+        double glassTinted        = 0.2;    // electrochromic glass, duty 1
+        double lampGain           = 0.6;    // internal light added by artificialLight at duty 1
+        double lightTau           = 2.0;    // lamps and glass response time [s]
+
+        double humidityDay        = 0.6;    // ambient humidity at sunrise/sunset
+        double humidityDrop       = 0.25;   // ambient humidity drop at noon
+        double humidityNight      = 0.7;    // ambient humidity at night
+        double humidityTau        = 900.0;  // exchange with the outside air [s]
+        double nebulizerGain      = 0.003;  // humidity rate at nebulizer duty 1 [1/s]
+        double humidityDisturbance = 0.0;   // random humidity disturbance intensity
+
+        double sensorNoise        = 0.0;    // std deviation of the sensor readings
+        uint32_t seed             = 1;
+    };
+
+    struct Actuators {
+        double artificialLight;
+        double electrochromicGlass;
+        double nebulizer;
+    };
+
+    GreenhousePlant();
+    explicit GreenhousePlant(const Params &params);
+
+    void step(double dt, const Actuators &u);   // advance the model by dt seconds
+
+    double time() const { return time_; }       // seconds since start
+    double hourOfDay() const;
+    double sunFactor() const;                   // clear-sky sun elevation factor (0.0 - 1.0)
+
+    /* True values */
+    double externalLight() const { return external_; }
+    double internalLight() const { return internal_; }
+    double humidity() const { return humidity_; }
+    double cloudCover() const { return cloud_; }
+
+    /* Sensor readings (true value plus noise, clamped like an ADC) */
+    double readExternalLight();
+    double readInternalLight();
+    double readHumidity();
+
+private:
+    double ambientHumidity() const;
+    double sensor(double value);
+
+    Params params_;
+    std::mt19937 rng_;
+    std::normal_distribution<double> gauss_;
+
+    double time_;
+    double cloud_;
+    double external_;
+    double internal_;
+    double humidity_;
+};
+
+#endif // PLANT_H
@@ -0,0 +1,169 @@
+/*
+ * seqlock_stress.cpp
+ *
+ *  Stress test of SeqLock on real host threads: one writer publishes
+ *  states derived from a counter as fast as it can while the readers check
+ *  that every snapshot is internally consistent (all the fields from the
+ *  same write) and never goes back in time.
+ *
+ *  Run on ControlState and on a large struct, which widens the window for
+ *  a torn copy. Exits with 1 if any reader saw a torn snapshot.
+ *
+ *      seqlock_stress [seconds per case]
+ */
+
+#include "control_state.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Wide {
+    uint32_t n;
+    uint32_t words[63];
+};
+
+ControlState makeState(uint32_t n)
+{
+    ControlState state;
+
+    n &= 0x7FFFFFFF;                        // both signs fit a sensor_value_t
+    state.lightReference = (sensor_value_t)n;
+    state.umidityReference = -(sensor_value_t)n;
+    state.pid1Running = n & 1;
+    state.pid2Running = (n >> 1) & 1;
+    state.pid3Running = (n >> 2) & 1;
+
+    return state;
+}
+
+bool consistent(const ControlState &state, uint32_t &n)
+{
+    n = (uint32_t)state.lightReference;
+
+    ControlState expected = makeState(n);
+    return state.umidityReference == expected.umidityReference &&
+           state.pid1Running == expected.pid1Running &&
+           state.pid2Running == expected.pid2Running &&
+           state.pid3Running == expected.pid3Running;
+}
+
+Wide makeWide(uint32_t n)
+{
+    Wide wide;
+
+    wide.n = n;
+    for (int i = 0; i < 63; i++) {
+        wide.words[i] = n * 2654435761u + i;
+    }
+
+    return wide;
+}
+
+bool consistent(const Wide &wide, uint32_t &n)
+{
+    n = wide.n;
+
+    for (int i = 0; i < 63; i++) {
+        if (wide.words[i] != n * 2654435761u + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Result {
+    uint64_t writes;
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;
+    uint64_t backwards;
+};
+
+template <typename T, typename Make>
+Result hammer(const char *name, Make make, int readers, double seconds)
+{
+    SeqLock<T> lock(make(0));
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0), retries(0), torn(0), backwards(0);
+    uint64_t writes = 0;
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&] {
+            uint64_t myReads = 0, myRetries = 0, myTorn = 0, myBackwards = 0;
+            uint32_t last = 0;
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                T value;
+                uint32_t n;
+
+                while (!lock.tryRead(value)) {
+                    myRetries++;
+                }
+                myReads++;
+
+                if (!consistent(value, n)) {
+                    myTorn++;
+                } else if (n < last) {
+                    myBackwards++;
+                } else {
+                    last = n;
+                }
+            }
+
+            reads += myReads;
+            retries += myRetries;
+            torn += myTorn;
+            backwards += myBackwards;
+        });
+    }
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; i++) {
+            writes++;
+            lock.write(make((uint32_t)writes));
+        }
+    }
+    stop = true;
+
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    Result result = { writes, reads, retries, torn, backwards };
+    printf("  %-14s %12llu %12llu %12llu %8llu %10llu\n", name, (unsigned long long)result.writes,
+           (unsigned long long)result.reads, (unsigned long long)result.retries,
+           (unsigned long long)result.torn, (unsigned long long)result.backwards);
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    int readers = (int)std::thread::hardware_concurrency() - 1;
+
+    if (readers < 3) {
+        readers = 3;
+    }
+
+    printf("SeqLock stress: 1 writer, %d readers, %.1f s per case\n\n", readers, seconds);
+    printf("  %-14s %12s %12s %12s %8s %10s\n", "state", "writes", "reads", "retries", "torn", "backwards");
+
+    Result control = hammer<ControlState>("ControlState", makeState, readers, seconds);
+    Result wide = hammer<Wide>("256 bytes", makeWide, readers, seconds);
+
+    bool failed = control.torn || control.backwards || wide.torn || wide.backwards;
+    printf("\n%s\n", failed ? "FAILED: torn or stale snapshot" : "ok");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,628 @@
+/*
+ * sim.cpp
+ *
+ *  Virtual clock, scheduler and timer events of the host build (see sim.h)
+ */
+
+#include "sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+struct Task {
+    enum E_TASK_STATE { READY, SLEEPING, WAITING, TERMINATED };
+
+    std::string name;
+    int priority;
+    E_TASK_STATE state;
+    sim_time_t wake;                    // SLEEPING: wake-up time, WAITING: deadline (-1 = none)
+    std::function<bool()> ready;        // WAITING: wake-up condition
+    bool timedOut;
+    uint64_t lastRun;                   // round-robin order among equal priorities
+    sim_time_t cpu;                     // CPU time charged to this thread
+    std::function<void()> entry;
+
+    // Hand-off gate: the host thread backing this task runs only while open
+    std::mutex gateMutex;
+    std::condition_variable gateCv;
+    bool gateOpen;
+};
+
+namespace {
+
+struct TimerEvent {
+    int id;
+    sim_time_t when;
+    sim_time_t period;                  // 0 = one-shot
+    std::function<void()> callback;
+};
+
+struct State {
+    std::vector<Task *> tasks;
+    std::vector<TimerEvent> timers;
+    std::vector<std::function<void(sim_time_t, sim_time_t)>> advanceHooks;
+    std::vector<std::function<void(FILE *)>> reportHooks;
+
+    Task *current = nullptr;
+    std::atomic<bool> started{false};
+    std::atomic<sim_time_t> now{0};
+
+    sim_time_t end;
+    sim_time_t quantum;
+    sim_time_t sliceStart = 0;
+    sim_time_t idle = 0;
+    sim_time_t sleep = 0;
+    sim_time_t deepSleep = 0;
+    sim_time_t deepSleepLatency;
+    int deepSleepLocks = 0;
+    uint64_t wakeups = 0;
+    double awakeBudget;                 // % of the time, < 0: none
+    sim_time_t isr = 0;
+    bool inIsr = false;
+
+    uint64_t runCounter = 0;
+    uint64_t contextSwitches = 0;
+    int nextTimerId = 1;
+    int unnamedThreads = 0;
+
+    HalCounters counters = {};
+    std::chrono::steady_clock::time_point wallStart;
+
+    State()
+    {
+        end = (sim_time_t)(envDouble("SIM_SECONDS", 600.0) * NS_PER_S);
+        quantum = (sim_time_t)(envDouble("SIM_QUANTUM_MS", 5.0) * NS_PER_MS);
+        deepSleepLatency = (sim_time_t)(envDouble("SIM_DEEP_SLEEP_LATENCY_MS", 3.0) * NS_PER_MS);
+        awakeBudget = envDouble("SIM_POWER_BUDGET", -1.0);
+        wallStart = std::chrono::steady_clock::now();
+    }
+};
+
+// Never destroyed: parked host threads still reference it at process exit
+State &state()
+{
+    static State *s = new State;
+    return *s;
+}
+
+thread_local Task *self_ = nullptr;
+
+Task *me()
+{
+    if (self_ != nullptr) {
+        return self_;
+    }
+
+    State &s = state();
+    bool expected = false;
+
+    // The first thread touching the simulation is the Mbed "main" thread
+    if (s.started.compare_exchange_strong(expected, true)) {
+        Task *t = new Task;
+        t->name = "main";
+        t->priority = 24;               // osPriorityNormal
+        t->state = Task::READY;
+        t->wake = -1;
+        t->timedOut = false;
+        t->lastRun = ++s.runCounter;
+        t->cpu = 0;
+        t->gateOpen = false;
+
+        s.tasks.push_back(t);
+        s.current = t;
+        self_ = t;
+    }
+
+    return self_;   // nullptr for host threads foreign to the simulation
+}
+
+void openGate(Task *t)
+{
+    std::lock_guard<std::mutex> lock(t->gateMutex);
+    t->gateOpen = true;
+    t->gateCv.notify_one();
+}
+
+void parkOnGate(Task *t)
+{
+    std::unique_lock<std::mutex> lock(t->gateMutex);
+    t->gateCv.wait(lock, [t] { return t->gateOpen; });
+    t->gateOpen = false;
+}
+
+void switchTo(Task *next, bool exiting)
+{
+    State &s = state();
+    Task *prev = self_;
+
+    s.current = next;
+    s.sliceStart = s.now;
+    s.contextSwitches++;
+    next->lastRun = ++s.runCounter;
+
+    openGate(next);
+    if (!exiting) {
+        parkOnGate(prev);
+    }
+}
+
+void stepTo(sim_time_t t)
+{
+    State &s = state();
+    sim_time_t from = s.now;
+
+    if (t <= from) {
+        return;
+    }
+
+    for (auto &hook : s.advanceHooks) {
+        hook(from, t);
+    }
+    s.now = t;
+
+    if (t >= s.end) {
+        finish();
+    }
+}
+
+void advance(sim_time_t target)
+{
+    State &s = state();
+
+    while (true) {
+        int due = -1;
+
+        for (size_t i = 0; i < s.timers.size(); i++) {
+            if (s.timers[i].when <= target && (due < 0 || s.timers[i].when < s.timers[due].when)) {
+                due = (int)i;
+            }
+        }
+
+        if (due < 0) {
+            break;
+        }
+
+        stepTo(s.timers[due].when);
+
+        std::function<void()> callback = s.timers[due].callback;
+        if (s.timers[due].period > 0) {
+            s.timers[due].when += s.timers[due].period;
+        } else {
+            s.timers.erase(s.timers.begin() + due);
+        }
+
+        s.inIsr = true;
+        callback();
+        s.inIsr = false;
+    }
+
+    stepTo(target);
+}
+
+void promote()
+{
+    State &s = state();
+
+    for (Task *t : s.tasks) {
+        if (t->state == Task::SLEEPING && t->wake <= s.now) {
+            t->state = Task::READY;
+        } else if (t->state == Task::WAITING) {
+            if (t->ready()) {
+                t->state = Task::READY;
+                t->timedOut = false;
+            } else if (t->wake >= 0 && t->wake <= s.now) {
+                t->state = Task::READY;
+                t->timedOut = true;
+            }
+        }
+    }
+}
+
+Task *pickBest()
+{
+    Task *best = nullptr;
+
+    promote();
+    for (Task *t : state().tasks) {
+        if (t->state != Task::READY) {
+            continue;
+        }
+        if (best == nullptr || t->priority > best->priority ||
+            (t->priority == best->priority && t->lastRun < best->lastRun)) {
+            best = t;
+        }
+    }
+
+    return best;
+}
+
+sim_time_t nextEventTime()
+{
+    State &s = state();
+    sim_time_t next = -1;
+
+    for (Task *t : s.tasks) {
+        if ((t->state == Task::SLEEPING || t->state == Task::WAITING) && t->wake >= 0) {
+            if (next < 0 || t->wake < next) {
+                next = t->wake;
+            }
+        }
+    }
+    for (const TimerEvent &e : s.timers) {
+        if (next < 0 || e.when < next) {
+            next = e.when;
+        }
+    }
+
+    return next;
+}
+
+void preempt()
+{
+    State &s = state();
+    Task *self = self_;
+    Task *best = pickBest();
+
+    if (best == nullptr || best == self) {
+        return;
+    }
+
+    if (best->priority > self->priority ||
+        (best->priority == self->priority && s.now - s.sliceStart >= s.quantum)) {
+        switchTo(best, false);
+    }
+}
+
+/*
+ * Gives the CPU away after the running thread stopped being READY, idling
+ * the virtual clock until some thread becomes runnable again.
+ */
+void dispatch(bool exiting)
+{
+    State &s = state();
+
+    while (true) {
+        Task *best = pickBest();
+
+        if (best != nullptr) {
+            if (best != self_) {
+                switchTo(best, exiting);
+            }
+            return;
+        }
+
+        sim_time_t next = nextEventTime();
+        if (next < 0) {
+            fprintf(stderr, "sim: no runnable thread and no pending event\n");
+            finish();
+        }
+
+        if (next > s.now) {
+            sim_time_t interval = next - s.now;
+
+            s.idle += interval;
+            if (s.deepSleepLocks == 0 && interval >= s.deepSleepLatency) {
+                s.deepSleep += interval;
+            } else {
+                s.sleep += interval;
+            }
+            s.wakeups++;
+            advance(next);
+        } else {
+            advance(s.now);
+        }
+    }
+}
+
+} // namespace
+
+HalCounters &counters()
+{
+    return state().counters;
+}
+
+sim_time_t now()
+{
+    me();
+    return state().now;
+}
+
+sim_time_t idleTime()
+{
+    return state().idle;
+}
+
+void lockDeepSleep()
+{
+    state().deepSleepLocks++;
+}
+
+void unlockDeepSleep()
+{
+    state().deepSleepLocks--;
+}
+
+sim_time_t sleepTime()
+{
+    return state().sleep;
+}
+
+sim_time_t deepSleepTime()
+{
+    return state().deepSleep;
+}
+
+uint64_t wakeups()
+{
+    return state().wakeups;
+}
+
+void consume(sim_time_t ns)
+{
+    State &s = state();
+    Task *self = me();
+
+    if (self == nullptr) {
+        return;
+    }
+
+    if (s.inIsr) {
+        s.isr += ns;
+        return;
+    }
+
+    /* Split the interval at pending events, so a woken thread preempts on time */
+    sim_time_t end = s.now + ns;
+    while (s.now < end) {
+        sim_time_t next = nextEventTime();
+        if (next <= s.now || next > end) {
+            next = end;
+        }
+
+        self->cpu += next - s.now;
+        advance(next);
+        preempt();
+    }
+}
+
+Task *spawn(std::function<void()> entry, int priority, const char *name)
+{
+    State &s = state();
+    Task *creator = me();
+    Task *t = new Task;
+
+    if (name != nullptr) {
+        t->name = name;
+    } else {
+        t->name = "thread" + std::to_string(++s.unnamedThreads);
+    }
+    t->priority = priority;
+    t->state = Task::READY;
+    t->wake = -1;
+    t->timedOut = false;
+    t->lastRun = ++s.runCounter;
+    t->cpu = 0;
+    t->entry = entry;
+    t->gateOpen = false;
+
+    s.tasks.push_back(t);
+
+    std::thread([t] {
+        self_ = t;
+        parkOnGate(t);
+
+        t->entry();
+
+        t->state = Task::TERMINATED;
+        dispatch(true);
+    }).detach();
+
+    if (creator != nullptr && !s.inIsr) {
+        preempt();
+    }
+
+    return t;
+}
+
+void join(Task *task)
+{
+    waitUntil([task] { return task->state == Task::TERMINATED; });
+}
+
+void setPriority(Task *task, int priority)
+{
+    task->priority = priority;
+    reschedule();
+}
+
+int priority(Task *task)
+{
+    return task->priority;
+}
+
+const char *name(Task *task)
+{
+    return task->name.c_str();
+}
+
+void sleepUntil(sim_time_t when)
+{
+    Task *self = me();
+
+    if (self == nullptr || state().inIsr) {
+        return;
+    }
+
+    consume(COST_KERNEL_CALL);
+    if (when <= state().now) {
+        return;
+    }
+
+    self->state = Task::SLEEPING;
+    self->wake = when;
+    dispatch(false);
+}
+
+void yield()
+{
+    State &s = state();
+
+    if (me() == nullptr || s.inIsr) {
+        return;
+    }
+
+    s.sliceStart = s.now - s.quantum;
+    preempt();
+}
+
+void reschedule()
+{
+    if (me() == nullptr || state().inIsr) {
+        return;
+    }
+
+    preempt();
+}
+
+bool waitUntil(const std::function<bool()> &ready, sim_time_t deadline)
+{
+    Task *self = me();
+
+    if (ready()) {
+        return true;
+    }
+
+    if (self == nullptr || state().inIsr) {
+        return false;
+    }
+
+    self->state = Task::WAITING;
+    self->ready = ready;
+    self->wake = deadline;
+    self->timedOut = false;
+    dispatch(false);
+    self->ready = nullptr;
+
+    return !self->timedOut;
+}
+
+bool inIsr()
+{
+    return state().inIsr;
+}
+
+int addTimer(sim_time_t first, sim_time_t period, std::function<void()> callback)
+{
+    State &s = state();
+    TimerEvent e;
+
+    me();
+    e.id = s.nextTimerId++;
+    e.when = first;
+    e.period = period;
+    e.callback = callback;
+    s.timers.push_back(e);
+
+    return e.id;
+}
+
+void removeTimer(int id)
+{
+    State &s = state();
+
+    for (size_t i = 0; i < s.timers.size(); i++) {
+        if (s.timers[i].id == id) {
+            s.timers.erase(s.timers.begin() + i);
+            return;
+        }
+    }
+}
+
+void onAdvance(std::function<void(sim_time_t, sim_time_t)> hook)
+{
+    state().advanceHooks.push_back(hook);
+}
+
+void onReport(std::function<void(FILE *)> hook)
+{
+    state().reportHooks.push_back(hook);
+}
+
+double envDouble(const char *name, double fallback)
+{
+    const char *value = getenv(name);
+
+    if (value == nullptr || *value == '\0') {
+        return fallback;
+    }
+
+    return strtod(value, nullptr);
+}
+
+void setDuration(double seconds)
+{
+    State &s = state();
+    s.end = s.now + (sim_time_t)(seconds * NS_PER_S);
+}
+
+void finish()
+{
+    State &s = state();
+    double simulated = (double)s.now / NS_PER_S;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - s.wallStart).count();
+
+    fflush(stdout);
+    printf("\n=== simulation report ===\n");
+    printf("simulated time    : %.3f s\n", simulated);
+    printf("wall-clock time   : %.3f s (%.1fx real time)\n", wall, wall > 0 ? simulated / wall : 0.0);
+    double awake = simulated > 0 ? 100.0 * (s.now - s.idle) / s.now : 0.0;
+    printf("cpu idle          : %.2f %%\n", simulated > 0 ? 100.0 * s.idle / s.now : 0.0);
+    printf("  sleep           : %.2f %%\n", simulated > 0 ? 100.0 * s.sleep / s.now : 0.0);
+    printf("  deep sleep      : %.2f %%\n", simulated > 0 ? 100.0 * s.deepSleep / s.now : 0.0);
+    printf("cpu awake         : %.2f %%", awake);
+    if (s.awakeBudget >= 0.0) {
+        printf(" (budget %.2f %%: %s)", s.awakeBudget, awake <= s.awakeBudget ? "ok" : "over");
+    }
+    printf("\n");
+    printf("wake-ups          : %llu (%.1f per second)\n", (unsigned long long)s.wakeups,
+           simulated > 0 ? s.wakeups / simulated : 0.0);
+    printf("interrupt time    : %.6f s\n", (double)s.isr / NS_PER_S);
+    printf("context switches  : %llu\n", (unsigned long long)s.contextSwitches);
+
+    printf("\n%-16s %5s %12s %8s\n", "thread", "prio", "cpu [s]", "cpu %");
+    for (Task *t : s.tasks) {
+        printf("%-16s %5d %12.6f %8.2f\n", t->name.c_str(), t->priority, (double)t->cpu / NS_PER_S,
+               s.now > 0 ? 100.0 * t->cpu / s.now : 0.0);
+    }
+
+    printf("\n%-16s %14s %14s\n", "hal", "count", "per second");
+    const struct { const char *name; uint64_t count; } rows[] = {
+        { "adc conversions", s.counters.adcConversions },
+        { "pwm writes",      s.counters.pwmWrites },
+        { "gpio writes",     s.counters.gpioWrites },
+        { "gpio reads",      s.counters.gpioReads },
+        { "console chars",   s.counters.consoleChars },
+    };
+    for (const auto &row : rows) {
+        printf("%-16s %14llu %14.1f\n", row.name, (unsigned long long)row.count,
+               simulated > 0 ? row.count / simulated : 0.0);
+    }
+
+    for (auto &hook : s.reportHooks) {
+        printf("\n");
+        hook(stdout);
+    }
+
+    fflush(stdout);
+    std::_Exit(s.awakeBudget >= 0.0 && awake > s.awakeBudget ? 1 : 0);
+}
+
+} // namespace sim
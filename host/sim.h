@@ -0,0 +1,107 @@
+/*
+ * sim.h
+ *
+ *  Discrete-event core of the host build: a virtual clock, a cooperative
+ *  priority scheduler for the simulated RTOS threads and the timer events
+ *  behind Ticker/Timeout.
+ *
+ *  Only one simulated thread executes at a time. Simulated time advances
+ *  when a thread sleeps or blocks (the CPU goes idle) or when it calls a HAL
+ *  primitive, which charges the primitive's CPU cost to the caller and acts
+ *  as a preemption point (higher priority thread woken, round-robin slice
+ *  expired). Code that never touches the HAL therefore runs in zero
+ *  simulated time.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+namespace sim {
+
+typedef int64_t sim_time_t;     // simulated time in nanoseconds
+
+const sim_time_t NS_PER_US = 1000;
+const sim_time_t NS_PER_MS = 1000000;
+const sim_time_t NS_PER_S  = 1000000000;
+
+/*
+ *  Simulated CPU cost of the HAL primitives (ns)
+ */
+const sim_time_t COST_ADC_CONVERSION = 10 * NS_PER_US;
+const sim_time_t COST_PWM_WRITE      = 2 * NS_PER_US;
+const sim_time_t COST_GPIO_WRITE     = 100;
+const sim_time_t COST_GPIO_READ      = 100;
+const sim_time_t COST_TIMER_READ     = 500;
+const sim_time_t COST_KERNEL_CALL    = 1 * NS_PER_US;
+
+/*
+ *  Counters of HAL activity, reported at the end of the run
+ */
+struct HalCounters {
+    uint64_t adcConversions;
+    uint64_t pwmWrites;
+    uint64_t gpioWrites;
+    uint64_t gpioReads;
+    uint64_t consoleChars;
+};
+
+HalCounters &counters();
+
+/* Clock */
+sim_time_t now();
+sim_time_t idleTime();              // time with no thread ready to run
+void consume(sim_time_t ns);        // charge CPU time to the running thread (preemption point)
+
+/*
+ *  Power: an idle interval is spent in deep sleep when no deep sleep lock
+ *  is held and it lasts at least the deep sleep latency (wake-up time of
+ *  the clocks, SIM_DEEP_SLEEP_LATENCY_MS, default 3), else in sleep. Every
+ *  idle interval ends with a wake-up (thread deadline or interrupt).
+ */
+void lockDeepSleep();
+void unlockDeepSleep();
+sim_time_t sleepTime();
+sim_time_t deepSleepTime();
+uint64_t wakeups();
+
+/* Threads */
+struct Task;
+
+Task *spawn(std::function<void()> entry, int priority, const char *name);
+void join(Task *task);
+void setPriority(Task *task, int priority);
+int  priority(Task *task);
+const char *name(Task *task);
+
+void sleepUntil(sim_time_t when);
+void yield();
+void reschedule();                  // preemption point after a wake-up (EventFlags::set, ...)
+
+/*
+ * Blocks the running thread until ready() returns true or the deadline
+ * (absolute, -1 = forever) expires. Returns false on timeout.
+ */
+bool waitUntil(const std::function<bool()> &ready, sim_time_t deadline = -1);
+
+bool inIsr();
+
+/* Timer events (interrupt context) */
+int  addTimer(sim_time_t first, sim_time_t period, std::function<void()> callback);
+void removeTimer(int id);
+
+/* Hooks */
+void onAdvance(std::function<void(sim_time_t from, sim_time_t to)> hook);
+void onReport(std::function<void(FILE *out)> hook);
+
+/* Run control */
+double envDouble(const char *name, double fallback);
+void setDuration(double seconds);   // end the run after seconds more of simulated time
+[[noreturn]] void finish();         // print the report and terminate the process
+
+} // namespace sim
+
+#endif // SIM_H
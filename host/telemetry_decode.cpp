@@ -0,0 +1,94 @@
+/*
+ * telemetry_decode.cpp
+ *
+ *  Decodes the binary telemetry stream written by Telemetry (telemetry.h)
+ *  into CSV on stdout. Records are found by their sync word and accepted
+ *  only with a valid checksum, so the decoder resynchronizes after
+ *  corrupted or partial data. Gaps in the sequence number are the records
+ *  dropped by the firmware.
+ *
+ *      telemetry_decode [file]         (stdin when no file is given)
+ *
+ *  In the host simulation: SIM_SERIAL_OUT=telemetry.bin build/greenhouse_sim
+ */
+
+#include "telemetry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#undef printf
+
+namespace {
+
+/* Same order as E_STATE and E_DAY_NIGHT_STATE in lighting.h */
+const char *const STATE_NAMES[] = { "Start", "Pull Up", "Pull Down", "Passive", "Pull Up Night" };
+const char *const DAY_NIGHT_NAMES[] = { "Day", "Night" };
+
+const char *name(const char *const *names, size_t count, uint8_t value)
+{
+    return value < count ? names[value] : "?";
+}
+
+double unit(uint16_t value)
+{
+    return value / 65535.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (in == nullptr) {
+        fprintf(stderr, "telemetry_decode: cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+
+    printf("time_s,sequence,state,day_night,external,internal,humidity,light_ref,humidity_ref,"
+           "artificial,glass,nebulizer\n");
+
+    const size_t size = sizeof(telemetry_record_t);
+    unsigned long records = 0, skipped = 0, gaps = 0;
+    bool first = true;
+    uint16_t expected = 0;
+
+    for (size_t pos = 0; pos + size <= data.size();) {
+        telemetry_record_t r;
+        memcpy(&r, &data[pos], size);
+
+        if (r.sync != TELEMETRY_SYNC || telemetry_checksum(r) != 0) {
+            pos++;
+            skipped++;
+            continue;
+        }
+
+        if (!first && r.sequence != expected) {
+            gaps += (uint16_t)(r.sequence - expected);
+        }
+        first = false;
+        expected = r.sequence + 1;
+
+        printf("%.3f,%u,%s,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", r.timestampMs / 1000.0,
+               r.sequence, name(STATE_NAMES, 5, r.state), name(DAY_NIGHT_NAMES, 2, r.dayNight),
+               unit(r.externalLight), unit(r.internalLight), unit(r.umidity), unit(r.lightReference),
+               unit(r.umidityReference), unit(r.artificialLight), unit(r.electrochromicGlass),
+               unit(r.nebulizer));
+
+        records++;
+        pos += size;
+    }
+
+    fprintf(stderr, "telemetry_decode: %lu records, %lu missing (dropped), %lu bytes skipped\n",
+            records, gaps, skipped);
+
+    return 0;
+}
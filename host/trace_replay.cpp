@@ -0,0 +1,396 @@
+/*
+ * trace_replay.cpp
+ *
+ *  Replays a sensor trace written by TraceRecorder (trace.h) through the
+ *  controller code: the acquisition filters and calibrations, the
+ *  Supervisor (day/night hysteresis, lighting state machine, humidity
+ *  window) and the PID bank of the zones, on the virtual clock of the
+ *  trace and as fast as the CPU allows. Prints the actuator trajectory as
+ *  CSV on stdout: a line at every change of state or day/night and every
+ *  interval seconds of trace time (0: every main loop step). A summary
+ *  goes to stderr.
+ *
+ *      trace_replay [-i interval_s] trace.bin
+ *
+ *  Every acquisition period is followed by the PID tick, then by the main
+ *  loop steps that used its snapshot, the order of the thread priorities
+ *  on target. The output depends only on the trace, so two builds can be
+ *  compared on the same recording.
+ *
+ *  In the host simulation the trace is recorded with TRACE_RECORD=1:
+ *      make DEFS=-DTRACE_RECORD=1 BUILD=build/record
+ *      SIM_SERIAL_OUT=trace.bin build/record/greenhouse_sim
+ *  make replay-check does both and compares the mean duties of the
+ *  simulation and of the replay.
+ */
+
+#include "trace.h"
+#include "greenhouse.h"
+#include "supervisor.h"
+#include "zone.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#undef printf
+
+namespace {
+
+/* Same order as E_STATE and E_DAY_NIGHT_STATE in lighting.h */
+const char *const STATE_NAMES[] = { "Start", "Pull Up", "Pull Down", "Passive", "Pull Up Night" };
+const char *const DAY_NIGHT_NAMES[] = { "Day", "Night" };
+
+struct Record {
+    uint8_t type;
+    uint8_t length;
+    const uint8_t *payload;
+};
+
+/* Sequential reader of the records, resynchronizing on the sync byte */
+class TraceReader {
+public:
+    explicit TraceReader(FILE *in) : in_(in), start_(0), end_(0), skipped_(0) {}
+
+    void rewind()
+    {
+        ::rewind(in_);
+        start_ = end_ = 0;
+        skipped_ = 0;
+    }
+
+    bool next(Record &record)
+    {
+        while (true) {
+            if (!fill(4)) {
+                return false;
+            }
+
+            const uint8_t *bytes = &buffer_[start_];
+            size_t size = 4 + (size_t)bytes[2];
+
+            if (bytes[0] != TRACE_SYNC || !fill(size)) {
+                skip();
+                continue;
+            }
+
+            bytes = &buffer_[start_];
+            if (trace_checksum(bytes, size) != 0) {
+                skip();
+                continue;
+            }
+
+            record.type = bytes[1];
+            record.length = bytes[2];
+            record.payload = bytes + 3;
+            start_ += size;
+            return true;
+        }
+    }
+
+    unsigned long skipped() const { return skipped_; }
+
+private:
+    void skip()
+    {
+        start_++;
+        skipped_++;
+    }
+
+    /* At least count bytes from start_, false at the end of the file */
+    bool fill(size_t count)
+    {
+        if (end_ - start_ >= count) {
+            return true;
+        }
+
+        memmove(buffer_, &buffer_[start_], end_ - start_);
+        end_ -= start_;
+        start_ = 0;
+        end_ += fread(&buffer_[end_], 1, sizeof(buffer_) - end_, in_);
+
+        return end_ - start_ >= count;
+    }
+
+    FILE *in_;
+    uint8_t buffer_[65536];
+    size_t start_;
+    size_t end_;
+    unsigned long skipped_;
+};
+
+uint32_t get32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+bool getVarint(const uint8_t *&p, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void noPrint(unsigned char *str)
+{
+    (void)str;
+}
+
+void noTimer(void)
+{
+}
+
+/* Controller state of the replay */
+struct Replay {
+    SensorFilter filters[E_SENSORS];
+    sensor_snapshot_t snapshot;
+    Supervisor supervisor;
+    ZoneController zones;
+    ControlState published;             // as read by the PID thread
+
+    std::vector<trace_step_t> steps;    // sorted by sequence
+    size_t nextStep;
+
+    double interval;
+    double nextLine;
+    int lastState;
+    int lastDayNight;
+    uint32_t rateHz;
+    uint32_t firstTimestampMs;
+    bool started;
+
+    uint64_t periods;
+    uint64_t gaps;
+    uint64_t stepsRun;
+    uint64_t pulseSum[E_ZONE_LOOPS];
+    uint32_t nextSequence;
+
+    static const supervisor_hooks_t HOOKS;
+
+    Replay(double intervalS)
+        : snapshot(), supervisor(HOOKS), zones(1.0f / PID_RATE_HZ, PWM_PERIOD_US), published(),
+          nextStep(0), interval(intervalS), nextLine(0.0), lastState(-1), lastDayNight(-1),
+          rateHz(SENSOR_RATE_HZ), firstTimestampMs(0), started(false), periods(0), gaps(0), stepsRun(0),
+          pulseSum(), nextSequence(0)
+    {
+        zone_t zone = { E_SENSOR_INTERNAL_LIGHT, E_SENSOR_UMIDITY, nullptr, nullptr, nullptr };
+        zones.setLimits(E_ZONE_PULL_UP, PULL_UP_LIMITS);
+        zones.setLimits(E_ZONE_PULL_DOWN, PULL_DOWN_LIMITS);
+        zones.setLimits(E_ZONE_UMIDITY, UMIDITY_LIMITS);
+        zones.bootDuty(PWM_BOOT_DUTY);
+        zones.addZone(zone, PULL_UP_GAINS, PULL_DOWN_GAINS, UMIDITY_GAINS);
+    }
+
+    double seconds(uint32_t timestampMs) const
+    {
+        return (timestampMs - firstTimestampMs) / 1000.0;
+    }
+
+    /* One acquisition period, its PID tick and the main loop steps on its snapshot */
+    void period(uint32_t sequence, uint32_t timestampMs, uint8_t mask, const uint16_t *raw)
+    {
+        if (!started) {
+            firstTimestampMs = timestampMs;
+            started = true;
+        } else if (sequence != nextSequence) {
+            gaps++;
+        }
+        nextSequence = sequence + 1;
+
+        for (int i = 0; i < E_SENSORS; i++) {
+            if (mask & (1 << i)) {
+                filters[i].add(raw[i]);
+                snapshot.value[i] = SENSOR_CALIBRATION[i]->convert(filters[i].value());
+            }
+        }
+        snapshot.sequence = sequence;
+        periods++;
+
+        zones.calculate(snapshot, published);
+        zones.write();                              // the pulse widths the actuators get
+        for (int loop = 0; loop < E_ZONE_LOOPS; loop++) {
+            pulseSum[loop] += (uint64_t)zones.appliedWidthUs(0, (E_ZONE_LOOP)loop);
+        }
+
+        while (nextStep < steps.size() && steps[nextStep].sequence <= sequence) {
+            const trace_step_t &step = steps[nextStep++];
+            if (step.sequence < sequence) {
+                continue;                           // its snapshot was lost
+            }
+
+            supervisor.step(step.events, snapshot);
+            published = supervisor.control();
+            stepsRun++;
+            line(timestampMs);
+        }
+    }
+
+    void line(uint32_t timestampMs)
+    {
+        double t = seconds(timestampMs);
+        int state = (int)supervisor.lighting().state();
+        int dayNight = (int)supervisor.dayNight();
+
+        if (state == lastState && dayNight == lastDayNight && t < nextLine) {
+            return;
+        }
+
+        printf("%.2f,%u,%s,%s,%.4f,%.4f,%d,%d,%d\n", t, (unsigned)snapshot.sequence, STATE_NAMES[state],
+               DAY_NIGHT_NAMES[dayNight], sensor_float(published.lightReference),
+               sensor_float(published.umidityReference), zones.appliedWidthUs(0, E_ZONE_PULL_UP),
+               zones.appliedWidthUs(0, E_ZONE_PULL_DOWN), zones.appliedWidthUs(0, E_ZONE_UMIDITY));
+
+        lastState = state;
+        lastDayNight = dayNight;
+        if (t >= nextLine) {
+            nextLine = t + interval;
+        }
+    }
+};
+
+const supervisor_hooks_t Replay::HOOKS = { noPrint, noTimer, noTimer };
+
+/* Decodes a samples record into periods */
+bool replaySamples(Replay &replay, const Record &record)
+{
+    if (record.length < 8) {
+        return false;
+    }
+
+    uint32_t sequence = get32(record.payload);
+    uint32_t timestampMs = get32(record.payload + 4);
+    const uint8_t *p = record.payload + 8;
+    const uint8_t *end = record.payload + record.length;
+    uint16_t raw[TRACE_CHANNELS_MAX] = {};
+    uint8_t seen = 0;
+
+    for (uint32_t k = 0; p < end; k++) {
+        uint8_t mask = *p++;
+
+        for (int i = 0; i < TRACE_CHANNELS_MAX; i++) {
+            if ((mask & (1 << i)) == 0) {
+                continue;
+            }
+
+            uint32_t value;
+            if (!getVarint(p, end, value)) {
+                return false;
+            }
+
+            if (seen & (1 << i)) {
+                int32_t delta = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+                raw[i] = (uint16_t)(raw[i] + delta);
+            } else {
+                raw[i] = (uint16_t)value;
+                seen |= (uint8_t)(1 << i);
+            }
+        }
+
+        replay.period(sequence + k, timestampMs + k * 1000 / replay.rateHz, mask, raw);
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    double interval = 60.0;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
+        fprintf(stderr, "usage: trace_replay [-i interval_s] trace.bin\n");
+        return 1;
+    }
+
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "trace_replay: cannot open %s\n", path);
+        return 1;
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+    Replay *replay = new Replay(interval);
+    TraceReader reader(in);
+    Record record;
+
+    /* First pass: the main loop steps, merged with the samples by sequence */
+    while (reader.next(record)) {
+        if (record.type == E_TRACE_STEP && record.length == 9) {
+            trace_step_t step = { get32(record.payload), get32(record.payload + 4), record.payload[8] };
+            replay->steps.push_back(step);
+        } else if (record.type == E_TRACE_START && record.length == 3) {
+            replay->rateHz = (uint32_t)record.payload[0] | ((uint32_t)record.payload[1] << 8);
+        }
+    }
+    std::stable_sort(replay->steps.begin(), replay->steps.end(),
+                     [](const trace_step_t &a, const trace_step_t &b) { return a.sequence < b.sequence; });
+
+    if (replay->rateHz == 0) {
+        fprintf(stderr, "trace_replay: no start record\n");
+        return 1;
+    }
+
+    /* Second pass: the samples */
+    printf("time_s,sequence,state,day_night,light_ref,humidity_ref,artificial_us,glass_us,nebulizer_us\n");
+
+    unsigned long corrupted = 0;
+    uint32_t lastTimestampMs = 0;
+    reader.rewind();
+    while (reader.next(record)) {
+        if (record.type == E_TRACE_SAMPLES) {
+            if (!replaySamples(*replay, record)) {
+                corrupted++;
+            }
+            lastTimestampMs = get32(record.payload + 4);
+        }
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double traced = replay->seconds(lastTimestampMs);
+    double ticks = replay->periods > 0 ? (double)replay->periods * PWM_PERIOD_US : 1.0;
+
+    fprintf(stderr, "replayed %.1f s of trace in %.3f s (%.0fx real time)\n", traced, wall,
+            wall > 0 ? traced / wall : 0.0);
+    fprintf(stderr, "periods %llu, main loop steps %llu of %zu, sequence gaps %llu, "
+            "bad records %lu, skipped bytes %lu\n",
+            (unsigned long long)replay->periods, (unsigned long long)replay->stepsRun, replay->steps.size(),
+            (unsigned long long)replay->gaps, corrupted, reader.skipped());
+    fprintf(stderr, "mean duty: artificialLight %.3f  electrochromicGlass %.3f  nebulizer %.3f\n",
+            replay->pulseSum[E_ZONE_PULL_UP] / ticks, replay->pulseSum[E_ZONE_PULL_DOWN] / ticks,
+            replay->pulseSum[E_ZONE_UMIDITY] / ticks);
+    fprintf(stderr, "PWM writes (suppressed): artificialLight %lu (%lu)  electrochromicGlass %lu (%lu)  "
+            "nebulizer %lu (%lu)\n",
+            (unsigned long)replay->zones.writesIssued(E_ZONE_PULL_UP),
+            (unsigned long)replay->zones.writesSuppressed(E_ZONE_PULL_UP),
+            (unsigned long)replay->zones.writesIssued(E_ZONE_PULL_DOWN),
+            (unsigned long)replay->zones.writesSuppressed(E_ZONE_PULL_DOWN),
+            (unsigned long)replay->zones.writesIssued(E_ZONE_UMIDITY),
+            (unsigned long)replay->zones.writesSuppressed(E_ZONE_UMIDITY));
+    fprintf(stderr, "edges:");
+    for (size_t edge = 0; edge < LightingMachine::edges(); edge++) {
+        fprintf(stderr, " %u:%lu", (unsigned)(edge + 1), (unsigned long)replay->supervisor.lighting().edgeCount(edge));
+    }
+    fprintf(stderr, "\n");
+
+    fclose(in);
+    return 0;
+}
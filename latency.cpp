@@ -0,0 +1,58 @@
+#include "latency.h"
+
+LatencyHistogram::LatencyHistogram(const char *name)
+    : name_(name), count_(0), min_(UINT32_MAX), max_(0) {
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+        buckets_[b].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t count, uint32_t max, unsigned percent) const
+{
+    /* Rank of the percentile, rounded up */
+    uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += bucket(b);
+        if (seen >= rank) {
+            uint32_t upper = b < 31 ? (2U << b) - 1 : UINT32_MAX;
+            return upper < max ? upper : max;
+        }
+    }
+
+    return max;
+}
+
+latency_summary_t LatencyHistogram::summary() const
+{
+    latency_summary_t s;
+
+    s.count = count_.load(std::memory_order_relaxed);
+    s.min = s.count > 0 ? min_.load(std::memory_order_relaxed) : 0;
+    s.max = max_.load(std::memory_order_relaxed);
+    s.p50 = percentile(s.count, s.max, 50);
+    s.p99 = percentile(s.count, s.max, 99);
+
+    return s;
+}
+
+static unsigned long toNs(uint32_t cycles)
+{
+    return (unsigned long)((uint64_t)cycles * 1000000000ULL / cycle_counter_hz());
+}
+
+void LatencyHistogram::print() const
+{
+    latency_summary_t s = summary();
+
+    printf("%-8s n %lu min %lu p50 %lu p99 %lu max %lu ns |", name_, (unsigned long)s.count,
+           toNs(s.min), toNs(s.p50), toNs(s.p99), toNs(s.max));
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+        uint32_t n = bucket(b);
+        if (n > 0) {
+            printf(" %u:%lu", b, (unsigned long)n);
+        }
+    }
+    printf("\n");
+}
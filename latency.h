@@ -0,0 +1,86 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include "cycle_counter.h"
+
+#define LATENCY_BUCKETS 32      // bucket b: durations of [2^b, 2^(b+1)) cycles (0 and 1 in bucket 0)
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;               // cycles
+    uint32_t max;
+    uint32_t p50;               // upper edge of the bucket of the percentile, at most max
+    uint32_t p99;
+} latency_summary_t;
+
+/*
+ *  Log2 histogram of the duration of a stage, in cycle counter ticks.
+ *
+ *  record() is called by the single thread running the stage: a few loads
+ *  and stores, no lock and no read-modify-write. Any other thread can read
+ *  the histogram at any time (relaxed atomics); a reader racing with
+ *  record() may see the new count before the new bucket, never a torn word.
+ */
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(const char *name);
+
+    void record(uint32_t cycles)
+    {
+        unsigned b = cycles > 1 ? 31 - __builtin_clz(cycles) : 0;
+
+        buckets_[b].store(buckets_[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (cycles < min_.load(std::memory_order_relaxed)) {
+            min_.store(cycles, std::memory_order_relaxed);
+        }
+        if (cycles > max_.load(std::memory_order_relaxed)) {
+            max_.store(cycles, std::memory_order_relaxed);
+        }
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    latency_summary_t summary() const;
+    uint32_t bucket(unsigned b) const { return buckets_[b].load(std::memory_order_relaxed); }
+    const char *name() const { return name_; }
+
+    void print() const;         // one console line: summary in ns and the non-empty buckets (cycles)
+
+private:
+    uint32_t percentile(uint32_t count, uint32_t max, unsigned percent) const;
+
+    const char *name_;
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> min_;
+    std::atomic<uint32_t> max_;
+    std::atomic<uint32_t> buckets_[LATENCY_BUCKETS];
+};
+
+/*
+ *  Scoped probe: records the lifetime of the object. A null histogram
+ *  disables the probe (optional instrumentation).
+ */
+class LatencyProbe {
+public:
+    explicit LatencyProbe(LatencyHistogram *histogram)
+        : histogram_(histogram), start_(histogram != nullptr ? cycle_counter_read() : 0) {}
+
+    explicit LatencyProbe(LatencyHistogram &histogram) : LatencyProbe(&histogram) {}
+
+    ~LatencyProbe()
+    {
+        if (histogram_ != nullptr) {
+            histogram_->record((uint32_t)(cycle_counter_read() - start_));
+        }
+    }
+
+private:
+    LatencyProbe(const LatencyProbe &) = delete;
+    LatencyProbe &operator=(const LatencyProbe &) = delete;
+
+    LatencyHistogram *histogram_;
+    cycle_t start_;
+};
+
+#endif // LATENCY_H
@@ -0,0 +1,149 @@
+#include "lighting.h"
+
+static bool isDay(const lighting_context_t &ctx);
+static bool isNight(const lighting_context_t &ctx);
+static bool dayBelowReference(const lighting_context_t &ctx);
+static bool dayAboveReference(const lighting_context_t &ctx);
+static bool dayNotBelowReference(const lighting_context_t &ctx);
+static bool dayBelowMinimum(const lighting_context_t &ctx);
+static bool dayAboveMaximum(const lighting_context_t &ctx);
+static void enterStart(lighting_context_t &ctx);
+static void enterPullUp(lighting_context_t &ctx);
+static void enterPullDown(lighting_context_t &ctx);
+static void enterPassive(lighting_context_t &ctx);
+static void enterPullUpNight(lighting_context_t &ctx);
+
+/*
+ *  Lighting controller: entry hooks select the PIDs and print the state,
+ *  edges are numbered as in the original design (row n-1 is edge n)
+ */
+constexpr LightingMachine::Table LIGHTING_TABLE = {
+    {
+        // entry            exit
+        { enterStart,       nullptr },  // E_START: does nothing
+        { enterPullUp,      nullptr },  // E_PULL_UP
+        { enterPullDown,    nullptr },  // E_PULL_DOWN
+        { enterPassive,     nullptr },  // E_PASSIVE
+        { enterPullUpNight, nullptr },  // E_PULL_UP_NIGHT
+    },
+    {
+        // from             to                  guard                   action
+        { E_START,          E_PULL_UP,          dayBelowReference,      nullptr },  // edge 1
+        { E_PULL_UP,        E_PASSIVE,          dayAboveReference,      nullptr },  // edge 2
+        { E_PASSIVE,        E_PULL_UP,          dayBelowMinimum,        nullptr },  // edge 3
+        { E_PASSIVE,        E_PULL_DOWN,        dayAboveMaximum,        nullptr },  // edge 4
+        { E_PULL_DOWN,      E_PASSIVE,          dayBelowReference,      nullptr },  // edge 5
+        { E_PULL_UP_NIGHT,  E_START,            isDay,                  nullptr },  // edge 6
+        { E_START,          E_PULL_UP_NIGHT,    isNight,                nullptr },  // edge 7
+        { E_START,          E_PULL_DOWN,        dayNotBelowReference,   nullptr },  // edge 8
+        { E_PULL_UP,        E_PULL_UP_NIGHT,    isNight,                nullptr },  // edge 9
+        { E_PASSIVE,        E_PULL_UP_NIGHT,    isNight,                nullptr },  // edge 10
+        { E_PULL_DOWN,      E_PULL_UP_NIGHT,    isNight,                nullptr },  // edge 11
+    }
+};
+
+static_assert(LIGHTING_TABLE.valid(), "lighting state table");
+
+E_DAY_NIGHT_STATE getCurrentDayNightState(E_DAY_NIGHT_STATE prevState, light_t externalLight)
+{
+	E_DAY_NIGHT_STATE currState;
+
+	switch (prevState)
+	{
+		case E_DAY:
+			if (externalLight < DAY_TO_NIGHT_THRESHOLD)
+				currState = E_NIGHT;
+			else
+				currState = E_DAY;
+			break;
+
+		case E_NIGHT:
+			if (externalLight > NIGHT_TO_DAY_THRESHOLD)
+				currState = E_DAY;
+			else
+				currState = E_NIGHT;
+			break;
+
+		default:
+			currState = prevState;
+			break;
+	}
+
+	return currState;
+}
+
+/*
+ *  Guards of the lighting state machine
+ */
+static bool isDay(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY;
+}
+
+static bool isNight(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_NIGHT;
+}
+
+static bool dayBelowReference(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY && ctx.internalLight < DAYLIGHT_REFERENCE;
+}
+
+static bool dayAboveReference(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY && ctx.internalLight > DAYLIGHT_REFERENCE;
+}
+
+static bool dayNotBelowReference(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY && !(ctx.internalLight < DAYLIGHT_REFERENCE);
+}
+
+static bool dayBelowMinimum(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY && ctx.internalLight < MIN_DAYLIGHT;
+}
+
+static bool dayAboveMaximum(const lighting_context_t &ctx)
+{
+    return ctx.dayNight == E_DAY && ctx.internalLight > MAX_DAYLIGHT;
+}
+
+/*
+ *  Entry hooks: run only on a transition into the state
+ */
+static void enterStart(lighting_context_t &ctx)
+{
+    ctx.control->pid1Running = false;
+    ctx.control->pid2Running = false;
+    ctx.print((unsigned char*)"Start");
+}
+
+static void enterPullUp(lighting_context_t &ctx)
+{
+    ctx.control->pid1Running = true;
+    ctx.control->pid2Running = false;
+    ctx.print((unsigned char*)"Pull Up");
+}
+
+static void enterPullDown(lighting_context_t &ctx)
+{
+    ctx.control->pid1Running = false;
+    ctx.control->pid2Running = true;
+    ctx.print((unsigned char*)"Pull Down");
+}
+
+static void enterPassive(lighting_context_t &ctx)
+{
+    ctx.control->pid1Running = false;
+    ctx.control->pid2Running = false;
+    ctx.print((unsigned char*)"Passive");
+}
+
+static void enterPullUpNight(lighting_context_t &ctx)
+{
+    ctx.control->pid1Running = true;
+    ctx.control->pid2Running = false;
+    ctx.print((unsigned char*)"Pull Up Night");
+}
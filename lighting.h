@@ -0,0 +1,54 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include "control_state.h"
+#include "state_machine.h"
+#include "calibration.h"
+
+/* Thresholds as calibrated integers, fixed at compile time */
+#define DAY_TO_NIGHT_THRESHOLD	SENSOR_LEVEL(0.15)
+#define NIGHT_TO_DAY_THRESHOLD  SENSOR_LEVEL(0.25)
+
+#define MAX_DAYLIGHT    SENSOR_LEVEL(0.85)
+#define MIN_DAYLIGHT    SENSOR_LEVEL(0.4)
+
+typedef enum
+{
+	E_DAY,
+	E_NIGHT
+}E_DAY_NIGHT_STATE;
+
+typedef enum
+{
+	E_START,
+    E_PULL_UP,
+	E_PULL_DOWN,
+	E_PASSIVE,
+    E_PULL_UP_NIGHT
+}E_STATE;
+
+typedef sensor_value_t light_t;
+typedef sensor_value_t umidity_t;
+typedef int32_t duty_t;             // PWM pulse width (us)
+
+/* Inputs of the lighting state machine and the state it drives */
+typedef struct
+{
+    E_DAY_NIGHT_STATE dayNight;
+    light_t internalLight;
+    ControlState *control;
+    void (*print)(unsigned char *str);  // state name on the display
+} lighting_context_t;
+
+#define LIGHTING_STATES     5
+#define LIGHTING_EDGES      11
+
+typedef StateMachine<E_STATE, lighting_context_t, LIGHTING_STATES, LIGHTING_EDGES> LightingMachine;
+
+extern const LightingMachine::Table LIGHTING_TABLE;
+
+const light_t DAYLIGHT_REFERENCE = (MAX_DAYLIGHT+MIN_DAYLIGHT) / 2;
+
+E_DAY_NIGHT_STATE getCurrentDayNightState(E_DAY_NIGHT_STATE prevState, light_t externalLight);
+
+#endif // LIGHTING_H
@@ -1,39 +1,39 @@
 #include "mbed.h"
-#include "pid.h"
+#include "periodic_task.h"
+#include "sensor_acquisition.h"
 #include "callbacks.h"
 #include "HD44780.h"
+#include "display_queue.h"
+#include "control_state.h"
+#include "telemetry.h"
+#include "lighting.h"
+#include "benchmarks.h"
+#include "latency.h"
+#include "zone.h"
+#include "greenhouse.h"
+#include "supervisor.h"
+#include "trace.h"
+#include "power.h"
 
-#define DAY_TO_NIGHT_THRESHOLD	0.15
-#define NIGHT_TO_DAY_THRESHOLD  0.25
+#include <atomic>
 
-#define MAX_DAYLIGHT    0.85
-#define MIN_DAYLIGHT    0.4
+#define UMIDITY_WINDOW  60s     // nebulizer run when the day humidity is low
 
-#define MAX_UMIDITY    1.0
-#define MIN_UMIDITY    0.4
+#define SPLASH_TIME     3s      // boot message on the LCD, the control loop does not wait for it
 
-#define UMIDITY_REFERENCE   0.6
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS  0       // 1: print the microbenchmarks (CSV, DWT cycles) at startup
+#endif
 
-typedef enum
-{
-	E_DAY,
-	E_NIGHT
-}E_DAY_NIGHT_STATE;
-
-typedef enum
-{
-	E_START,
-    E_PULL_UP,
-	E_PULL_DOWN,
-	E_PASSIVE,
-    E_PULL_UP_NIGHT
-}E_STATE;
+#ifndef TRACE_RECORD
+#define TRACE_RECORD    0       // 1: sensor trace instead of telemetry on the second UART (host/trace_replay)
+#endif
 
-typedef float light_t;
-typedef float umidity_t;
-typedef float duty_t;
+#ifndef LOW_POWER
+#define LOW_POWER       0       // 1: actuators at 0 suspended, deep sleep between the control bursts (pull-downs on D3, D5, D6)
+#endif
 
-const light_t DAYLIGHT_REFERENCE = (MAX_DAYLIGHT+MIN_DAYLIGHT) / 2;
+#define AWAKE_BUDGET    20      // CPU awake time budget, tenths of a percent (battery and solar panel sizing)
 
 /*
  *  GPIO
@@ -44,84 +44,141 @@ AnalogIn umiditySensor(A2);
 AnalogIn userLightReference(A3);
 AnalogIn userUmidityReference(A4);
 
+SensorAcquisition sensors(SENSOR_RATE_HZ, osPriorityHigh);
+
 PwmOut artificialLight(D3);
 PwmOut electrochromicGlass(D5);
 PwmOut nebulizer(D6);
 
-// Create a PID object
-PID pid1(1.0, 0.0, 0.0);    // pull up light    -->     artificialLight
-PID pid2(1.0, 0.0, 0.5);    // pull down light  -->     electrochromicGlass
-PID pid3(1.0, 0.0, 0.0);    // umidity          -->     nebulizer
+// Greenhouse zones: this board drives one
+ZoneController zones(1.0f / PID_RATE_HZ, PWM_PERIOD_US);
 
-bool pid1Running = false;
-bool pid2Running = false;
-bool pid3Running = false;
+SeqLock<ControlState> controlState;     // published once per main loop step, read by update_pid
 
-Ticker sensorsTicker;     // Ticker to read sensor data every 5 minutes
+PeriodicTask pidPeriod(PID_RATE_HZ);    // fixed-rate executor of update_pid
+
+LowPowerTimer bootTimer;                        // started first thing in main
+std::atomic<int32_t> firstOutputUs(-1);         // first PID output driven by a published state (us after boot)
+
+LowPowerTicker sensorsTicker;     // Ticker to read sensor data every 5 minutes
 Ticker pidTicker;         // Ticker to call PID at regular intervals
 
-Timer umidityTimer;       // Timer 1min for umidity
+LowPowerTimeout umidityTimeout;   // Timeout 1min for umidity (the low power timers do not block deep sleep)
+
+EventFlags mainEvents;    // the main loop sleeps until one of the EVENT_ flags is set
+
+PowerMonitor power(AWAKE_BUDGET);       // sleep and deep sleep shares, reported with the sensors
 
-volatile bool sensorReadAllowed = false; // Flag to indicate data readiness
+InterruptIn userButton(BUTTON1);        // press: print the latency histograms
 
-light_t     externalLight = 0;
-light_t     internalLight = 0;
-umidity_t   umidity = 0;
-light_t     lightReference = 0;
-umidity_t   umidityReference = 0;
+// Latency of the stages between the sensors and the actuators (cycle counter)
+LatencyHistogram latencySensors("sensors");     // acquisition period: conversions, filters, publication
+LatencyHistogram latencyPid("pid");             // PID bank pass of all the zones
+LatencyHistogram latencyPwm("pwm");             // PWM writes of a PID period
+LatencyHistogram latencyState("state");         // lighting and humidity state machines
+LatencyHistogram latencyLcd("lcd");             // lcd_flush of the display thread
+
+LatencyHistogram *const latencyStages[] = {
+    &latencySensors, &latencyPid, &latencyPwm, &latencyState, &latencyLcd
+};
 
 // Display
 DigitalOut registerSelect(D7);
 DigitalOut readWrite(D8);
 DigitalOut enable(D9);
-DigitalOut dataLine4(D10);
-DigitalOut dataLine5(D11);
-DigitalOut dataLine6(D12);
-DigitalOut dataLine7(D13);
+DigitalInOut dataLine4(D10, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine5(D11, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine6(D12, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine7(D13, PIN_OUTPUT, PullNone, 0);
+#if LCD_EIGHT_BIT
+DigitalInOut dataLine0(D2, PIN_OUTPUT, PullNone, 0);   // D0..D3, 8 bit interface only (LCD_EIGHT_BIT in callbacks.h)
+DigitalInOut dataLine1(D4, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine2(D14, PIN_OUTPUT, PullNone, 0);
+DigitalInOut dataLine3(D15, PIN_OUTPUT, PullNone, 0);
+#endif
+
+DisplayQueue display(osPriorityLow);    // the state machine only enqueues, the display thread draws
+
+// Telemetry: one binary record per main loop step on the second UART (TELEMETRY_TX, output only)
+BufferedSerial telemetrySerial(TELEMETRY_TX, NC, TELEMETRY_BAUD);
+#if TRACE_RECORD
+TraceRecorder trace(telemetrySerial, osPriorityLow);
+#else
+Telemetry telemetry(telemetrySerial, osPriorityLow);
+#endif
 
 // Forward declarations
-E_DAY_NIGHT_STATE getCurrentDayNightState(E_DAY_NIGHT_STATE prevState, light_t externalLight);
 void read_sensor_data();
+void umidity_timeout();
+void request_latency_dump();
 void update_pid();
-void startState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state);
-void pullUpState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state);
-void passiveState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state);
-void pullDownState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state);
-void pullUpNightState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state);
 void newPrintDisplay(unsigned char* str);
+void start_umidity_timer();
+void stop_umidity_timer();
 void printSensorsSecondLine(int s1, int s2);
 
+// Main loop decisions: lighting and humidity state machines
+const supervisor_hooks_t supervisorHooks = { newPrintDisplay, start_umidity_timer, stop_umidity_timer };
+Supervisor supervisor(supervisorHooks);
+
 
 int main(void)
 {
-	/* Initial state */
-    E_DAY_NIGHT_STATE dayNightState = E_DAY;
-	E_STATE state = E_START;
+    MBED_ASSERT(TELEMETRY_TX != CONSOLE_TX);    // binary records must not mix with the printf text
+    bootTimer.start();
+    cycle_counter_init();
+    sensors.profile(&latencySensors);
+    display.profile(&latencyLcd);
+    userButton.fall(&request_latency_dump);
 
     /* 
      *  Actuators 
      */
 
-	artificialLight.period(0.001f);
-    artificialLight.write(1.0);
+	artificialLight.period_us(PWM_PERIOD_US);
+    artificialLight.write(PWM_BOOT_DUTY);
 
-    electrochromicGlass.period(0.001f);
-    electrochromicGlass.write(1.0);
+    electrochromicGlass.period_us(PWM_PERIOD_US);
+    electrochromicGlass.write(PWM_BOOT_DUTY);
 
-    nebulizer.period(0.001f);
-    nebulizer.write(1.0);
+    nebulizer.period_us(PWM_PERIOD_US);
+    nebulizer.write(PWM_BOOT_DUTY);
 
     /* Sensors */
+    sensors.addChannel(&externalSensorLight,  *SENSOR_CALIBRATION[E_SENSOR_EXTERNAL_LIGHT], SENSOR_SLOW_DIV);
+    sensors.addChannel(&internalSensorLight,  *SENSOR_CALIBRATION[E_SENSOR_INTERNAL_LIGHT]);
+    sensors.addChannel(&umiditySensor,        *SENSOR_CALIBRATION[E_SENSOR_UMIDITY]);
+    sensors.addChannel(&userLightReference,   *SENSOR_CALIBRATION[E_SENSOR_USER_LIGHT], SENSOR_SLOW_DIV);
+    sensors.addChannel(&userUmidityReference, *SENSOR_CALIBRATION[E_SENSOR_USER_UMIDITY], SENSOR_SLOW_DIV);
+#if TRACE_RECORD
+    sensors.record(&trace);
+    trace.start(SENSOR_RATE_HZ, E_SENSORS);
+#endif
+    sensors.start();
+
     read_sensor_data(); // Perform an initial sensor data reading
     sensorsTicker.attach(&read_sensor_data, 1min);
 
     /* PID Controller */
-    Thread threadPID;
+    zone_t zone = { E_SENSOR_INTERNAL_LIGHT, E_SENSOR_UMIDITY, &artificialLight, &electrochromicGlass, &nebulizer };
+    zones.setLimits(E_ZONE_PULL_UP, PULL_UP_LIMITS);
+    zones.setLimits(E_ZONE_PULL_DOWN, PULL_DOWN_LIMITS);
+    zones.setLimits(E_ZONE_UMIDITY, UMIDITY_LIMITS);
+    zones.releaseIdle(LOW_POWER);
+    zones.bootDuty(PWM_BOOT_DUTY);
+    zones.addZone(zone, PULL_UP_GAINS, PULL_DOWN_GAINS, UMIDITY_GAINS);
+
+    Thread threadPID(osPriorityAboveNormal);
     threadPID.start(update_pid);
 
     /* 
      *  Display Callbacks & Init
      */
+#if LCD_BUS_MODE && LCD_EIGHT_BIT
+    register_bus8_callback(setBus8);
+#elif LCD_BUS_MODE
+    register_bus_callback(setBus);
+#else
     register_callback(setRegisterSelect,    E_CALLBACK_RS);
     register_callback(setReadWrite,         E_CALLBACK_RW);
     register_callback(setEnable,            E_CALLBACK_EN);
@@ -129,325 +186,205 @@ int main(void)
     register_callback(setDataLine5,         E_CALLBACK_DATA5);
     register_callback(setDataLine6,         E_CALLBACK_DATA6);
     register_callback(setDataLine7,         E_CALLBACK_DATA7);
+#if LCD_EIGHT_BIT
+    register_data_low_callbacks(setDataLine0, setDataLine1, setDataLine2, setDataLine3);
+#endif
+#endif
     register_callback(displayDelay,         E_DELAY);
-
+#if LCD_BUSY_FLAG
+#if LCD_EIGHT_BIT
+    register_read_callback(readDataLine7, setDataInput8, displayDelayUs);
+#else
+    register_read_callback(readDataLine7, setDataInput, displayDelayUs);
+#endif
+#endif
+
+#if RUN_BENCHMARKS
     init_LCD();
-    putCommand(DISPLAY_CLEAR_CMD);          		        // clear display
-	setCursor(0,0);    				                        // first line, first column, 1st position
-	writeString((unsigned char*)"Display LCD 4bit", false); // message
+    run_benchmarks(stdout, nullptr, LCD_BUS_MODE ? "bus" : "pin");
+#endif
 
-    ThisThread::sleep_for(chrono::seconds(3));  // Sleep 3 seconds
+    /* LCD init and splash in the display thread: the control loop starts right away */
+    display.splash(LCD_EIGHT_BIT ? "Display LCD 8bit" : "Display LCD 4bit", SPLASH_TIME);
+    display.start();
+#if !TRACE_RECORD
+    telemetry.start();
+#endif
 
-    /* Infinite loop */
+    sensor_snapshot_t snapshot = sensors.snapshot();
+    uint32_t lastConversions = sensors.conversions();
+    Kernel::Clock::time_point lastConversionsTime = Kernel::Clock::now();
+    power.update();                 // the first window starts with the main loop
+
+    sensors.notify(&mainEvents, EVENT_SNAPSHOT, SENSOR_SLOW_DIV);
+
+    /* Infinite loop: sleeps until a sensor, timer or snapshot event */
 	while (true)
 	{
-		dayNightState = getCurrentDayNightState(dayNightState, externalLight);
-        if (dayNightState == E_DAY)
-        {
-            lightReference = DAYLIGHT_REFERENCE;
-            umidityReference = UMIDITY_REFERENCE;
-        }
-        else if (dayNightState == E_NIGHT)
-        {
-            lightReference = userLightReference.read();
-            umidityReference = userUmidityReference.read();
-        }
-        
-        /* Updated every 5 minutes */
-        if (sensorReadAllowed)  
+        uint32_t events = mainEvents.wait_any(EVENT_ALL);
+
+        sensors.update(snapshot);   // latest values published by the acquisition thread
+
+#if TRACE_RECORD
+        trace.step(snapshot.sequence, (uint32_t)Kernel::Clock::now().time_since_epoch().count(), events);
+#endif
+
+        cycle_t stateStart = cycle_counter_read();
+
+        /* Day/night, references, lighting and humidity state machines */
+        supervisor.step(events, snapshot);
+
+        const ControlState &control = supervisor.control();
+        controlState.write(control);   // one consistent state for the PID thread
+        latencyState.record((uint32_t)(cycle_counter_read() - stateStart));
+
+#if !TRACE_RECORD
+        /* Telemetry record of this step (dropped, never blocking, if the ring is full) */
+        telemetry_sample_t sample;
+        sample.state = (uint8_t)supervisor.lighting().state();
+        sample.dayNight = (uint8_t)supervisor.dayNight();
+        sample.externalLight = sensor_float(snapshot.value[E_SENSOR_EXTERNAL_LIGHT]);
+        sample.internalLight = sensor_float(snapshot.value[E_SENSOR_INTERNAL_LIGHT]);
+        sample.umidity = sensor_float(snapshot.value[E_SENSOR_UMIDITY]);
+        sample.lightReference = sensor_float(control.lightReference);
+        sample.umidityReference = sensor_float(control.umidityReference);
+        sample.artificialLight = zones.appliedDuty(0, E_ZONE_PULL_UP);      // not PwmOut::read(): may be suspended
+        sample.electrochromicGlass = zones.appliedDuty(0, E_ZONE_PULL_DOWN);
+        sample.nebulizer = zones.appliedDuty(0, E_ZONE_UMIDITY);
+        telemetry.log(sample);
+#endif
+
+        /* Report after the state is published: at 9600 baud it takes ~0.3 s */
+        if (events & EVENT_SENSOR_READ)
         {
             printf("Reading data from sensors...\n");
 
-            externalLight = externalSensorLight.read();
-            internalLight = internalSensorLight.read();
-            umidity = umiditySensor.read();
-            
-            sensorReadAllowed = false;
+            const power_window_t &window = power.window();
+            if (power.update()) {
+                printf("CPU: awake %lu.%lu %% (budget %lu.%lu %%%s), sleep %lu.%lu %%, deep sleep %lu.%lu %%; "
+                       "since boot awake %lu.%lu %%\n",
+                       (unsigned long)(window.awake / 10), (unsigned long)(window.awake % 10),
+                       (unsigned long)(power.budgetPermille() / 10), (unsigned long)(power.budgetPermille() % 10),
+                       power.overBudget() ? ", over" : "",
+                       (unsigned long)(window.sleep / 10), (unsigned long)(window.sleep % 10),
+                       (unsigned long)(window.deepSleep / 10), (unsigned long)(window.deepSleep % 10),
+                       (unsigned long)(power.total().awake / 10), (unsigned long)(power.total().awake % 10));
+            }
+
+            Kernel::Clock::time_point now = Kernel::Clock::now();
+            uint32_t conversions = sensors.conversions();
+            long elapsedMs = (long)(now - lastConversionsTime).count();
+            if (elapsedMs > 0) {
+                printf("ADC: %lu conversions/s\n", (unsigned long)((conversions - lastConversions) * 1000ULL / elapsedMs));
+                lastConversions = conversions;
+                lastConversionsTime = now;
+            }
+            static bool startupReported = false;
+            if (!startupReported && firstOutputUs.load() >= 0) {
+                printf("Startup: first closed-loop PID output %ld us after boot\n", (long)firstOutputUs.load());
+                startupReported = true;
+            }
+            printf("PID: %lu ticks, %lu overruns, jitter mean %ld us max %ld us\n",
+                   (unsigned long)pidPeriod.ticks(), (unsigned long)pidPeriod.overruns(),
+                   (long)pidPeriod.jitterMeanUs(), (long)pidPeriod.jitterMaxUs());
+            printf("PWM writes: light %lu (%lu suppressed), glass %lu (%lu suppressed), nebulizer %lu (%lu suppressed), %d suspended\n",
+                   (unsigned long)zones.writesIssued(E_ZONE_PULL_UP), (unsigned long)zones.writesSuppressed(E_ZONE_PULL_UP),
+                   (unsigned long)zones.writesIssued(E_ZONE_PULL_DOWN), (unsigned long)zones.writesSuppressed(E_ZONE_PULL_DOWN),
+                   (unsigned long)zones.writesIssued(E_ZONE_UMIDITY), (unsigned long)zones.writesSuppressed(E_ZONE_UMIDITY),
+                   zones.suspended());
+            printf("LCD queue: depth %lu (max %lu), %lu enqueued, %lu coalesced, %lu dropped\n",
+                   (unsigned long)display.depth(), (unsigned long)display.maxDepth(),
+                   (unsigned long)display.enqueued(), (unsigned long)display.coalesced(),
+                   (unsigned long)display.dropped());
+#if TRACE_RECORD
+            printf("Trace: %lu bytes sent, %lu dropped\n",
+                   (unsigned long)trace.sent(), (unsigned long)trace.dropped());
+#else
+            printf("Telemetry: %lu logged, %lu sent, %lu dropped\n",
+                   (unsigned long)telemetry.logged(), (unsigned long)telemetry.sent(),
+                   (unsigned long)telemetry.dropped());
+#endif
+            printf("Edges:");
+            for (size_t edge = 0; edge < LightingMachine::edges(); edge++) {
+                printf(" %u:%lu", (unsigned)(edge + 1), (unsigned long)supervisor.lighting().edgeCount(edge));
+            }
+            printf("\n");
         }
-        
-        
-		/* State machine for controlling brightness */
-        switch (state)
-		{
-			case E_START:
-                startState(dayNightState, state);
-
-			break;
-
-			case E_PULL_UP:
-                pullUpState(dayNightState, state);
-				break;
-
-            case E_PASSIVE:
-                passiveState(dayNightState, state);
-				break;
-
-            case E_PULL_DOWN:
-                pullDownState(dayNightState, state);
-				break;
-
-            case E_PULL_UP_NIGHT:
-                pullUpNightState(dayNightState, state);
-                break;
-
-			default:
-				break;
-		}
-
-        /* State machine for controlling umidity */
-        static bool timerRunning = false;
-        switch (dayNightState)
-	    {
-            case E_DAY:
-                printf("Day\n");
-                
-                // Gestire umidita per 1 minuto  (TIMER)
-                if (umidity < MIN_UMIDITY && !timerRunning)
-                {
-                    umidityTimer.start();
-                    timerRunning = true;
-                    pid3Running = true;
-                }
-                else {
-                    pid3Running = false;
-                }
-
-                if (umidityTimer.elapsed_time().count() >= 60)
-                {
-                    umidityTimer.stop();
-                    umidityTimer.reset();
-                    timerRunning = false;
-                    pid3Running = false;
-                }
-
-                break;
-
-            case E_NIGHT:
-                printf("Night\n");
-                
-                umidityTimer.stop();
-                umidityTimer.reset();
-                timerRunning = false;
-
-                pid3Running = true;
-
-                break;
-
-            default:
-				break;
+
+        /* On demand, while the PID and acquisition threads keep recording */
+        if (events & EVENT_LATENCY_DUMP)
+        {
+            printf("Latency (cycle counter at %lu Hz, bucket b: [2^b, 2^(b+1)) cycles):\n",
+                   (unsigned long)cycle_counter_hz());
+            for (LatencyHistogram *histogram : latencyStages) {
+                histogram->print();
+            }
         }
 	}
 	
 	return 0;
 }
 
-E_DAY_NIGHT_STATE getCurrentDayNightState(E_DAY_NIGHT_STATE prevState, light_t externalLight)
+void read_sensor_data() 
 {
-	E_DAY_NIGHT_STATE currState;
-
-	switch (prevState)
-	{
-		case E_DAY:
-			if (externalLight < DAY_TO_NIGHT_THRESHOLD)
-				currState = E_NIGHT;
-			else
-				currState = E_DAY;
-			break;
-
-		case E_NIGHT:
-			if (externalLight > NIGHT_TO_DAY_THRESHOLD)
-				currState = E_DAY;
-			else
-				currState = E_NIGHT;
-			break;
-
-		default:
-			currState = prevState;
-			break;
-	}
+    mainEvents.set(EVENT_SENSOR_READ);
+}
 
-	return currState;
+void umidity_timeout()
+{
+    mainEvents.set(EVENT_UMIDITY_TIME);
 }
 
-void read_sensor_data() 
+void request_latency_dump()
 {
-    sensorReadAllowed = true;
+    mainEvents.set(EVENT_LATENCY_DUMP);
 }
 
 void update_pid()
 {
-    float output;
+    sensor_snapshot_t feedback = sensors.snapshot();
 
+    pidPeriod.start();
     while (true) {
-        // feedback
-        light_t internalLight = internalSensorLight.read();
-        umidity_t umidity = umiditySensor.read();
-
-        /*
-        *  PID 1
-        */
-        if (pid1Running) {
-            output = pid1.calculate(lightReference, internalLight); // Calculate the PID output
-            artificialLight.write(output); // Write the PID output to the actuator (0.0 to 1.0)
-        } else {
-            artificialLight.write(0.0);
-        }
-        
-        /*
-        *  PID 2
-        */
-        if (pid2Running) {
-            output = pid2.calculate(lightReference, internalLight); // Calculate the PID output
-            electrochromicGlass.write(output); // Write the PID output to the actuator (0.0 to 1.0)
-        } else {
-            electrochromicGlass.write(0.0);
-        }
+        pidPeriod.waitNextPeriod();
 
-        /*
-        *  PID 3
-        */
-        if (pid3Running) {
-            output = pid3.calculate(umidityReference, umidity); // Calculate the PID output
-            nebulizer.write(output); // Write the PID output to the actuator (0.0 to 1.0)
-        } else {
-            nebulizer.write(0.0);
-        }
-    }
-}
+        // feedback: same snapshot the state machine sees
+        sensors.update(feedback);
 
-void startState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state)
-{
-    printf("Start\n");
+        // references and running flags of the same state machine step, no lock
+        ControlState current = controlState.read();
 
-    /* Check if we should pass to the next state */
-	if (dayNightState == E_DAY) {
-        if (internalLight < DAYLIGHT_REFERENCE)
+        /* Every PID of every zone, one pass over the bank */
         {
-            state = E_PULL_UP; // edge 1
-            newPrintDisplay((unsigned char*)"Pull Up");
+            LatencyProbe probe(latencyPid);
+            zones.calculate(feedback, current);
         }
-        else {
-            state = E_PULL_DOWN; // edge 8
-            newPrintDisplay((unsigned char*)"Pull Down");
-        }
-    } 
-
-    if (dayNightState == E_NIGHT) 
-    {
-        state = E_PULL_UP_NIGHT;  // edge 7
-        newPrintDisplay((unsigned char*)"Pull Up Night");
-    }
 
-    /*
-     *  This state does nothing
-     */
-    pid1Running = false;
-    pid2Running = false;
-}
-
-void pullUpState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state)
-{
-    printf("Pull Up\n");
-    /* Check if we should pass to the next state */
-    if (dayNightState == E_DAY)
-    {
-        if (internalLight > DAYLIGHT_REFERENCE)
+        /* Write the PID outputs to the actuators (pulse widths) */
         {
-            state = E_PASSIVE;  // edge 2
-            newPrintDisplay((unsigned char*)"Passive");
-            return;
+            LatencyProbe probe(latencyPwm);
+            zones.write();
         }
-    }
-    else if (dayNightState == E_NIGHT)
-    {
-        state = E_PULL_UP_NIGHT;  // edge 9
-        newPrintDisplay((unsigned char*)"Pull Up Night");
-        return;
-    }
-
-    /* Handle the current state */
-    pid1Running = true;
-    pid2Running = false;
-}
 
-void passiveState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state)
-{
-    printf("Passive\n");
-
-    /* Check if we should pass to the next state */
-    if (dayNightState == E_DAY)
-    {
-        if (internalLight < MIN_DAYLIGHT)
-        { 
-            state = E_PULL_UP;  // edge 3
-            newPrintDisplay((unsigned char*)"Pull Up");
-            return;
-        }
-        else if (internalLight > MAX_DAYLIGHT)
-        {
-            state = E_PULL_DOWN;    // edge 4
-            newPrintDisplay((unsigned char*)"Pull Down");
-            return;
+        if (firstOutputUs.load(std::memory_order_relaxed) < 0 && controlState.sequence() != 0) {
+            firstOutputUs.store((int32_t)bootTimer.elapsed_time().count(), std::memory_order_relaxed);
         }
     }
-    else if (dayNightState == E_NIGHT)
-    {
-        state = E_PULL_UP_NIGHT;  // edge 10
-        newPrintDisplay((unsigned char*)"Pull Up Night");
-        return;
-    }
-    
-    /* Handle the current state */
-    pid1Running = false;
-    pid2Running = false;
 }
 
-void pullDownState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state)
+void newPrintDisplay(unsigned char* str)
 {
-    printf("Pull Down\n");
-
-    /* Check if we should pass to the next state */
-    if (dayNightState == E_DAY)
-    {
-        if (internalLight < DAYLIGHT_REFERENCE)
-        {
-            state = E_PASSIVE;  // edge 5
-            newPrintDisplay((unsigned char*)"Passive");
-        }
-    }
-    else if (dayNightState == E_NIGHT)
-    {
-        state = E_PULL_UP_NIGHT;  // edge 11
-        newPrintDisplay((unsigned char*)"Pull Up Night");
-    }
-
-    /* Handle the current state */
-    pid1Running = false;
-    pid2Running = true;
+    display.message((const char*)str);              // drawn later by the display thread
 }
 
-void pullUpNightState(E_DAY_NIGHT_STATE &dayNightState, E_STATE &state)
+void start_umidity_timer()
 {
-    printf("Pull Up Nigth\n");
-
-    /* Check if we should pass to the next state */
-    if (dayNightState == E_DAY)
-    {
-        state = E_START;    // edge 6
-        newPrintDisplay((unsigned char*)"Start");
-        return;
-    }
-    
-    /* Handle the current state */
-    pid1Running = true;
-    pid2Running = false;
+    umidityTimeout.attach(&umidity_timeout, UMIDITY_WINDOW);
 }
 
-void newPrintDisplay(unsigned char* str)
+void stop_umidity_timer()
 {
-    putCommand(DISPLAY_CLEAR_CMD);      // clear display
-	setCursor(0,0);                     // first line, first column, 1st position
-	writeString(str, false);            // message
+    umidityTimeout.detach();
 }
 
 void printSensorsSecondLine(int s1, int s2)
@@ -0,0 +1,67 @@
+#include "periodic_task.h"
+
+PeriodicTask::PeriodicTask(int rateHz)
+    : period_(1000 / rateHz), lastWakeUs_(0), ticks_(0), overruns_(0), missedPeriods_(0),
+      jitterLastUs_(0), jitterMaxUs_(0), jitterSumUs_(0) {
+    if (period_.count() < 1) {
+        period_ = Kernel::Clock::duration(1);   // at most one tick per RTOS tick
+    }
+}
+
+void PeriodicTask::start()
+{
+    Kernel::Clock::duration now = Kernel::Clock::now().time_since_epoch();
+
+    deadline_ = Kernel::Clock::time_point(now - now % period_);     // waitNextPeriod() adds the first period
+
+    timer_.reset();
+    timer_.start();
+    lastWakeUs_ = -1;
+}
+
+void PeriodicTask::waitNextPeriod()
+{
+    int periods = 1;
+
+    deadline_ += period_;
+
+    /* Overrun: skip the expired deadlines instead of running a burst of late ticks */
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    if (deadline_ < now) {
+        overruns_++;
+        while (deadline_ < now) {
+            deadline_ += period_;
+            missedPeriods_++;
+            periods++;
+        }
+    }
+
+    ThisThread::sleep_until(deadline_);
+
+    int64_t wakeUs = timer_.elapsed_time().count();
+    if (lastWakeUs_ >= 0) {
+        int64_t jitter = wakeUs - lastWakeUs_ - periods * chrono::duration_cast<chrono::microseconds>(period_).count();
+        if (jitter < 0) {
+            jitter = -jitter;
+        }
+
+        jitterLastUs_ = (int32_t)jitter;
+        jitterSumUs_ += jitter;
+        if (jitterLastUs_ > jitterMaxUs_) {
+            jitterMaxUs_ = jitterLastUs_;
+        }
+    }
+    lastWakeUs_ = wakeUs;
+
+    ticks_++;
+}
+
+float PeriodicTask::dt() const
+{
+    return chrono::duration<float>(period_).count();
+}
+
+int32_t PeriodicTask::jitterMeanUs() const
+{
+    return ticks_ > 1 ? (int32_t)(jitterSumUs_ / (ticks_ - 1)) : 0;
+}
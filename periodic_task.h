@@ -0,0 +1,49 @@
+#ifndef PERIODIC_TASK_H
+#define PERIODIC_TASK_H
+
+#include "mbed.h"
+
+/*
+ *  Fixed-rate executor for a control loop running in its own thread.
+ *
+ *  Deadlines are absolute (start + k * period), so the time spent in the loop
+ *  body does not accumulate as drift. When a deadline has already passed the
+ *  missed periods are skipped, keeping the phase and a constant dt.
+ *  The period is rounded to the RTOS tick (1 ms).
+ *
+ *  Deadlines fall on multiples of the period of the kernel clock, so tasks
+ *  with the same (or a multiple) period wake up on the same tick and run
+ *  as one burst: one wake-up of the CPU instead of one per task, with the
+ *  idle thread sleeping in between (tickless idle).
+ */
+class PeriodicTask {
+public:
+    explicit PeriodicTask(int rateHz);
+
+    void start();               // first deadline at the next multiple of the period
+    void waitNextPeriod();      // sleep until the next deadline
+
+    float dt() const;           // nominal period in seconds
+
+    uint32_t ticks() const { return ticks_; }
+    uint32_t overruns() const { return overruns_; }             // deadlines found already expired
+    uint32_t missedPeriods() const { return missedPeriods_; }   // periods skipped by the overruns
+    int32_t jitterLastUs() const { return jitterLastUs_; }      // |interval - period| of the last tick
+    int32_t jitterMaxUs() const { return jitterMaxUs_; }
+    int32_t jitterMeanUs() const;
+
+private:
+    Kernel::Clock::duration period_;
+    Kernel::Clock::time_point deadline_;
+    LowPowerTimer timer_;       // wake-up timestamps for the jitter, does not block deep sleep
+    int64_t lastWakeUs_;
+
+    uint32_t ticks_;
+    uint32_t overruns_;
+    uint32_t missedPeriods_;
+    int32_t jitterLastUs_;
+    int32_t jitterMaxUs_;
+    uint64_t jitterSumUs_;
+};
+
+#endif // PERIODIC_TASK_H
@@ -6,11 +6,15 @@ PID::PID(float kp, float ki, float kd)
 }
 
 float PID::calculate(float setpoint, float measured_value) {
-    float error = setpoint - measured_value;
-
     float dt = timer_.elapsed_time().count();  // Usa elapsed_time e count
     timer_.reset();  // Resetta il timer per il prossimo ciclo
 
+    return calculate(setpoint, measured_value, dt);
+}
+
+float PID::calculate(float setpoint, float measured_value, float dt) {
+    float error = setpoint - measured_value;
+
     float Pout = kp_ * error;
 
     integral_ += error * dt;
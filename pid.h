@@ -7,6 +7,7 @@ class PID {
 public:
     PID(float kp, float ki, float kd);
     float calculate(float setpoint, float measured_value);
+    float calculate(float setpoint, float measured_value, float dt);   // fixed step, dt in seconds
 
 private:
     float kp_;  // Guadagno proporzionale
@@ -0,0 +1,223 @@
+#include "pid_bank.h"
+#include "pid_engine.h"
+
+#include <math.h>
+
+#if PID_BANK_CMSIS_DSP
+#include "arm_math.h"
+#endif
+
+#if defined(__ARM_FEATURE_SAT) && __ARM_FEATURE_SAT
+#include <arm_acle.h>
+#endif
+
+/*
+ *  optimize() is a GCC attribute: armclang (ARMC6) and clang ignore it with
+ *  a warning, and vectorize from their own -O level.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#define PID_BANK_OPTIMIZE(...)  __attribute__((optimize(__VA_ARGS__)))
+#else
+#define PID_BANK_OPTIMIZE(...)
+#endif
+
+PIDBank::PIDBank()
+    : size_(0) {
+    for (int i = 0; i < PID_BANK_SIZE; i++) {
+        kp_[i] = 0.0f;
+        ki_[i] = 0.0f;
+        kd_[i] = 0.0f;
+        dt_[i] = 0.0f;
+        invDt_[i] = 0.0f;
+        setpoint_[i] = 0.0f;
+        measured_[i] = 0.0f;
+        active_[i] = 0;
+        output_[i] = 0.0f;
+        reset(i);
+    }
+}
+
+int PIDBank::add(float kp, float ki, float kd, float dt)
+{
+    if (size_ >= PID_BANK_SIZE || dt <= 0.0f) {
+        return -1;
+    }
+
+    kp_[size_] = kp;
+    ki_[size_] = ki;
+    kd_[size_] = kd;
+    dt_[size_] = dt;
+    invDt_[size_] = 1.0f / dt;
+    reset(size_);
+
+    return size_++;
+}
+
+void PIDBank::reset(int loop)
+{
+    integral_[loop] = 0.0f;
+    previousError_[loop] = 0.0f;
+}
+
+#if PID_BANK_CMSIS_DSP
+
+void PIDBank::calculate()
+{
+    uint32_t n = (uint32_t)lanes();
+
+    /* e = setpoint - measured, integral' = integral + e * dt */
+    arm_sub_f32(setpoint_, measured_, error_, n);
+    arm_mult_f32(error_, dt_, scratch_, n);
+    arm_add_f32(integral_, scratch_, nextIntegral_, n);
+
+    /* output = kd * (e - e[n-1]) / dt + ki * integral' + kp * e */
+    arm_sub_f32(error_, previousError_, scratch_, n);
+    arm_mult_f32(scratch_, invDt_, scratch_, n);
+    arm_mult_f32(scratch_, kd_, output_, n);
+    arm_mult_f32(nextIntegral_, ki_, scratch_, n);
+    arm_add_f32(output_, scratch_, output_, n);
+    arm_mult_f32(error_, kp_, scratch_, n);
+    arm_add_f32(output_, scratch_, output_, n);
+
+    /* Only the running loops move on */
+    for (uint32_t i = 0; i < n; i++) {
+        if (active_[i] != 0) {
+            integral_[i] = nextIntegral_[i];
+            previousError_[i] = error_[i];
+        } else {
+            output_[i] = 0.0f;
+        }
+    }
+}
+
+#else
+
+/*
+ *  One branch free pass. The selects of the inactive loops are if-converted
+ *  only without trapping math (no FP exception is used here), then the loop
+ *  vectorizes (4 loops per SSE/NEON instruction).
+ */
+PID_BANK_OPTIMIZE("tree-vectorize", "no-trapping-math")
+void PIDBank::calculate()
+{
+    const int n = lanes();
+
+    for (int i = 0; i < n; i++) {
+        float error = setpoint_[i] - measured_[i];
+        float previousError = previousError_[i];
+        float previousIntegral = integral_[i];
+
+        float Pout = kp_[i] * error;
+
+        float integral = previousIntegral + error * dt_[i];
+        float Iout = ki_[i] * integral;
+
+        float derivative = (error - previousError) * invDt_[i];
+        float Dout = kd_[i] * derivative;
+
+        float output = Pout + Iout + Dout;
+
+        bool active = active_[i] != 0;
+        output_[i] = active ? output : 0.0f;
+        integral_[i] = active ? integral : previousIntegral;
+        previousError_[i] = active ? error : previousError;
+    }
+}
+
+#endif
+
+/*
+ *  PIDBankQ15
+ */
+#define PID_Q15_COEFF_FRAC_BITS     (15 - PID_COEFF_INT_BITS)
+
+/* Kp and Kd / dt: the products with a Q15 error stay within 32 bits (gains checked by pid_gains_fit) */
+static int32_t coeff_q15(double value)
+{
+    return (int32_t)lround(value * (1 << PID_Q15_COEFF_FRAC_BITS));
+}
+
+/* Saturation to Q15: one SSAT on Cortex-M3/M4/M7, compare and select elsewhere (vectorized on the host) */
+static inline int32_t saturate_q15(int32_t value)
+{
+#if defined(__ARM_FEATURE_SAT) && __ARM_FEATURE_SAT
+    return __ssat(value, 16);
+#else
+    return value > Q15::RAW_MAX ? Q15::RAW_MAX : (value < Q15::RAW_MIN ? Q15::RAW_MIN : value);
+#endif
+}
+
+PIDBankQ15::PIDBankQ15()
+    : size_(0) {
+    for (int i = 0; i < PID_BANK_SIZE; i++) {
+        kp_[i] = 0;
+        kiDt_[i] = 0;
+        kdInvDt_[i] = 0;
+        integralLimit_[i] = 0;
+        setpoint_[i] = 0;
+        measured_[i] = 0;
+        active_[i] = 0;
+        output_[i] = 0;
+        reset(i);
+    }
+}
+
+int PIDBankQ15::add(float kp, float ki, float kd, float dt)
+{
+    if (size_ >= PID_BANK_SIZE || dt <= 0.0f || dt >= 1.0f || !pid_gains_fit(PIDGains(kp, ki, kd), dt)) {
+        return -1;
+    }
+
+    kp_[size_] = coeff_q15(kp);
+    kiDt_[size_] = (int32_t)lround((double)ki * dt * (1 << PID_Q15_KIDT_FRAC_BITS));
+    kdInvDt_[size_] = coeff_q15((double)kd / dt);
+
+    /* |Ki * dt * sum| <= 1.0: the integral term alone can saturate the output, no further */
+    int32_t kiMagnitude = kiDt_[size_] < 0 ? -kiDt_[size_] : kiDt_[size_];
+    integralLimit_[size_] = kiMagnitude != 0 ? ((int32_t)1 << (15 + PID_Q15_KIDT_FRAC_BITS)) / kiMagnitude : 0;
+
+    reset(size_);
+
+    return size_++;
+}
+
+void PIDBankQ15::reset(int loop)
+{
+    integral_[loop] = 0;
+    previousError_[loop] = 0;
+}
+
+/*
+ *  One branch free pass, as the float one; the products are rounded back
+ *  to Q15 before the sum (see the ranges in pid_bank.h). This is the pass
+ *  the firmware runs (ZoneController): on target the two Q15 saturations
+ *  are SSAT instructions, the rest single cycle MUL/MLA and shifts.
+ */
+PID_BANK_OPTIMIZE("tree-vectorize")
+void PIDBankQ15::calculate()
+{
+    const int n = lanes();
+    const int32_t half = 1 << (PID_Q15_COEFF_FRAC_BITS - 1);
+
+    for (int i = 0; i < n; i++) {
+        int32_t error = saturate_q15(setpoint_[i] - measured_[i]);
+        int32_t previousError = previousError_[i];
+        int32_t previousIntegral = integral_[i];
+
+        int32_t Pout = (kp_[i] * error + half) >> PID_Q15_COEFF_FRAC_BITS;
+
+        int32_t integral = previousIntegral + error;
+        int32_t limit = integralLimit_[i];
+        integral = integral > limit ? limit : (integral < -limit ? -limit : integral);
+        int32_t Iout = (kiDt_[i] * integral + (1 << (PID_Q15_KIDT_FRAC_BITS - 1))) >> PID_Q15_KIDT_FRAC_BITS;
+
+        int32_t Dout = (kdInvDt_[i] * (error - previousError) + half) >> PID_Q15_COEFF_FRAC_BITS;
+
+        int32_t output = saturate_q15(Pout + Iout + Dout);
+
+        bool active = active_[i] != 0;
+        output_[i] = active ? output : 0;
+        integral_[i] = active ? integral : previousIntegral;
+        previousError_[i] = active ? error : previousError;
+    }
+}
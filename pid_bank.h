@@ -0,0 +1,138 @@
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#include <stdint.h>
+#include "fixed_point.h"
+
+#define PID_BANK_SIZE   96          // loops: 32 zones x 3
+#define PID_BANK_LANES  4           // loops are processed in groups of PID_BANK_LANES (host SIMD width)
+
+#define PID_Q15_KIDT_FRAC_BITS  15  // Ki * dt of PIDBankQ15: (Ki * dt) * sum(e) <= 2^30
+
+#ifndef PID_BANK_CMSIS_DSP
+#define PID_BANK_CMSIS_DSP  0       // 1: vector passes with the CMSIS-DSP arm_*_f32 functions (target)
+#endif
+
+/*
+ *  Bank of independent PID loops in struct-of-arrays layout.
+ *
+ *  Gains, state (integral, previous error) and step (dt and 1/dt) of loop i
+ *  are element i of separate arrays, as well as its inputs and output, so
+ *  calculate() updates every loop in one pass over contiguous floats: the
+ *  compiler vectorizes it on the host, and on target the pass can run on
+ *  CMSIS-DSP (PID_BANK_CMSIS_DSP). Each loop computes the same positional
+ *  form as PID::calculate(setpoint, measured, dt), with the derivative
+ *  multiplied by 1/dt (same result within float rounding).
+ *
+ *  An inactive loop outputs 0 and keeps its state, like a PID that is not
+ *  called. The unused lanes up to a multiple of PID_BANK_LANES are inactive
+ *  loops with zero gains.
+ */
+class PIDBank {
+public:
+    PIDBank();
+
+    int add(float kp, float ki, float kd, float dt);    // loop index, -1 when full
+    void reset(int loop);                               // clear integral and previous error
+
+    void input(int loop, float setpoint, float measured, bool active)
+    {
+        setpoint_[loop] = setpoint;
+        measured_[loop] = measured;
+        active_[loop] = active ? 1 : 0;
+    }
+
+    void calculate();                                   // one pass over all the loops
+
+    float output(int loop) const { return output_[loop]; }
+    int size() const { return size_; }
+
+private:
+    int lanes() const { return (size_ + PID_BANK_LANES - 1) & ~(PID_BANK_LANES - 1); }
+
+    int size_;
+
+    /* Parameters */
+    alignas(16) float kp_[PID_BANK_SIZE];
+    alignas(16) float ki_[PID_BANK_SIZE];
+    alignas(16) float kd_[PID_BANK_SIZE];
+    alignas(16) float dt_[PID_BANK_SIZE];
+    alignas(16) float invDt_[PID_BANK_SIZE];
+
+    /* State */
+    alignas(16) float integral_[PID_BANK_SIZE];
+    alignas(16) float previousError_[PID_BANK_SIZE];
+
+    /* Inputs and outputs of a pass */
+    alignas(16) float setpoint_[PID_BANK_SIZE];
+    alignas(16) float measured_[PID_BANK_SIZE];
+    alignas(16) int32_t active_[PID_BANK_SIZE];       // 1: running, 0: output 0 and state frozen
+    alignas(16) float output_[PID_BANK_SIZE];
+
+#if PID_BANK_CMSIS_DSP
+    /* Intermediate vectors of the CMSIS-DSP pass */
+    alignas(16) float error_[PID_BANK_SIZE];
+    alignas(16) float nextIntegral_[PID_BANK_SIZE];
+    alignas(16) float scratch_[PID_BANK_SIZE];
+#endif
+};
+
+/*
+ *  The same bank in Q15, integer only: the one the zones run on target
+ *  (ZoneController), also on cores without an FPU.
+ *
+ *  Setpoints, measurements and outputs are Q15 (the calibrated sensor
+ *  values, calibration.h), the loops compute the positional form of
+ *  PIDBank with Kp and Kd / dt in Q7.8 (PID_COEFF_INT_BITS of headroom,
+ *  1/256 resolution, a product with a Q15 error fits in 32 bits):
+ *
+ *      output = Kp * e + (Ki * dt) * sum(e) + (Kd / dt) * (e - e[n-1])
+ *
+ *  The integral is the exact sum of the Q15 errors, dt is folded into the
+ *  Ki * dt coefficient (PID_Q15_KIDT_FRAC_BITS fraction bits), so an error
+ *  of one LSB still integrates. The sum is clamped where (Ki * dt) * sum
+ *  reaches the output range (anti-windup), so every product fits in 32
+ *  bits. The output saturates to [-1, 1).
+ */
+class PIDBankQ15 {
+public:
+    PIDBankQ15();
+
+    int add(float kp, float ki, float kd, float dt);    // loop index, -1 when full, dt not in (0, 1) s
+    void reset(int loop);                               // or gains out of range (pid_gains_fit)
+
+    void input(int loop, Q15 setpoint, Q15 measured, bool active)
+    {
+        setpoint_[loop] = setpoint.raw();
+        measured_[loop] = measured.raw();
+        active_[loop] = active ? 1 : 0;
+    }
+
+    void calculate();                                   // one pass over all the loops
+
+    Q15 output(int loop) const { return Q15::fromRaw((int16_t)output_[loop]); }
+    int size() const { return size_; }
+
+private:
+    int lanes() const { return (size_ + PID_BANK_LANES - 1) & ~(PID_BANK_LANES - 1); }
+
+    int size_;
+
+    /* Parameters: Kp and Kd / dt with PID_COEFF_INT_BITS integer bits, Ki * dt with PID_Q15_KIDT_FRAC_BITS */
+    alignas(16) int32_t kp_[PID_BANK_SIZE];
+    alignas(16) int32_t kiDt_[PID_BANK_SIZE];
+    alignas(16) int32_t kdInvDt_[PID_BANK_SIZE];
+    alignas(16) int32_t integralLimit_[PID_BANK_SIZE];
+
+    /* State */
+    alignas(16) int32_t integral_[PID_BANK_SIZE];         // sum of the Q15 errors
+    alignas(16) int32_t previousError_[PID_BANK_SIZE];
+
+    /* Inputs and outputs of a pass (Q15 in 32 bit lanes) */
+    alignas(16) int32_t setpoint_[PID_BANK_SIZE];
+    alignas(16) int32_t measured_[PID_BANK_SIZE];
+    alignas(16) int32_t active_[PID_BANK_SIZE];
+    alignas(16) int32_t output_[PID_BANK_SIZE];
+};
+
+#endif // PID_BANK_H
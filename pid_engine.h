@@ -0,0 +1,168 @@
+#ifndef PID_ENGINE_H
+#define PID_ENGINE_H
+
+#include "fixed_point.h"
+
+/*
+ *  Fixed-rate PID engine, templated over its numeric type.
+ *
+ *  With a constant dt the PID reduces to the incremental (velocity) form
+ *
+ *      y[n] = y[n-1] + A0 * e[n] + A1 * e[n-1] + A2 * e[n-2]
+ *
+ *      A0 = Kp + Ki * dt + Kd / dt
+ *      A1 = -Kp - 2 * Kd / dt
+ *      A2 = Kd / dt
+ *
+ *  which gives the same output as PID::calculate(setpoint, measured, dt),
+ *  with three multiply-accumulates and no division per step. The
+ *  coefficients are computed at compile time from constexpr gains.
+ *
+ *  Instances: PIDEngine<float>, PIDEngine<Q15>, PIDEngine<Q31>. The fixed
+ *  point versions saturate the output to [-1, 1), which also bounds the
+ *  integral action (no windup). Their coefficients saturate as well, so
+ *  constexpr gains are checked with static_assert(pid_engine_gains_fit()).
+ */
+
+struct PIDGains {
+    float kp;   // Guadagno proporzionale
+    float ki;   // Guadagno integrale
+    float kd;   // Guadagno derivativo
+
+    constexpr PIDGains(float p, float i, float d) : kp(p), ki(i), kd(d) {}
+};
+
+/*
+ *  Arithmetic used by the engine for each numeric type
+ */
+template <typename T>
+struct PIDArith;
+
+template <>
+struct PIDArith<float> {
+    typedef float coeff_t;
+    typedef float acc_t;
+
+    static constexpr coeff_t coeff(double value) { return (float)value; }
+    static acc_t mac(acc_t acc, coeff_t c, float x) { return acc + c * x; }
+    static acc_t clamp(acc_t acc) { return acc; }
+    static float narrow(acc_t acc) { return acc; }
+};
+
+/*
+ * Fixed point: the coefficients are int32 with PID_COEFF_INT_BITS integer
+ * bits of headroom (|A| < 128, e.g. Kd / dt = 0.5 / 0.01 = 50) and 24
+ * fraction bits, so Ki * dt = 0.02 is exact to 3e-8 instead of 1/256. The
+ * output y[n-1] is kept in a 64 bit accumulator with PID_ACC_EXTRA_BITS
+ * below the signal LSB: the products are added at that resolution and
+ * the output is rounded once, when it leaves the engine.
+ */
+#define PID_COEFF_INT_BITS  7
+#define PID_ACC_EXTRA_BITS  16      // accumulator fraction bits below the output LSB
+
+/* |value| < 2^PID_COEFF_INT_BITS: representable without saturating */
+constexpr bool pid_coeff_fits(double value)
+{
+    return value > -(double)(1 << PID_COEFF_INT_BITS) && value < (double)(1 << PID_COEFF_INT_BITS);
+}
+
+/* Gains of a PIDBankQ15 loop at dt: Kp, Ki and Kd / dt within the coefficient range */
+constexpr bool pid_gains_fit(const PIDGains &g, double dt)
+{
+    return dt > 0.0 && pid_coeff_fits(g.kp) && pid_coeff_fits(g.ki) && pid_coeff_fits(g.kd / dt);
+}
+
+/* Gains of a fixed point PIDEngine at dt: A0, A1 and A2 within the coefficient range */
+constexpr bool pid_engine_gains_fit(const PIDGains &g, double dt)
+{
+    return dt > 0.0 && pid_coeff_fits((double)g.kp + (double)g.ki * dt + (double)g.kd / dt) &&
+           pid_coeff_fits(-(double)g.kp - 2.0 * g.kd / dt) && pid_coeff_fits((double)g.kd / dt);
+}
+
+template <typename Storage, typename Wide, int FracBits>
+struct PIDArith<Fixed<Storage, Wide, FracBits> > {
+    typedef Fixed<Storage, Wide, FracBits> value_t;
+    typedef Fixed<int32_t, int64_t, 31 - PID_COEFF_INT_BITS> coeff_value_t;
+    typedef int32_t coeff_t;
+    typedef int64_t acc_t;     // output scaled by 2^(FracBits + PID_ACC_EXTRA_BITS)
+
+    static const int COEFF_FRAC_BITS = 31 - PID_COEFF_INT_BITS;
+    static const int PRODUCT_SHIFT = COEFF_FRAC_BITS - PID_ACC_EXTRA_BITS;
+
+    static constexpr coeff_t coeff(double value)
+    {
+        return coeff_value_t::saturate(coeff_value_t::round(value * (double)((int64_t)1 << COEFF_FRAC_BITS)));
+    }
+
+    /* |A * x| < 2^(FracBits + 31), three of them stay well within 64 bits after the shift */
+    static acc_t mac(acc_t acc, coeff_t c, value_t x)
+    {
+        return acc + (((int64_t)c * x.raw() + ((int64_t)1 << (PRODUCT_SHIFT - 1))) >> PRODUCT_SHIFT);
+    }
+
+    /* The state saturates to the output range [-1, 1) (no windup) */
+    static acc_t clamp(acc_t acc)
+    {
+        const acc_t high = ((acc_t)value_t::RAW_MAX << PID_ACC_EXTRA_BITS) | (((acc_t)1 << PID_ACC_EXTRA_BITS) - 1);
+        const acc_t low = (acc_t)value_t::RAW_MIN * ((acc_t)1 << PID_ACC_EXTRA_BITS);
+        return acc > high ? high : (acc < low ? low : acc);
+    }
+
+    static value_t narrow(acc_t acc)
+    {
+        return value_t::fromRaw(value_t::saturate((Wide)((acc + ((acc_t)1 << (PID_ACC_EXTRA_BITS - 1))) >> PID_ACC_EXTRA_BITS)));
+    }
+};
+
+template <typename T>
+class PIDEngine {
+public:
+    typedef PIDArith<T> arith_t;
+    typedef typename arith_t::coeff_t coeff_t;
+    typedef typename arith_t::acc_t acc_t;
+
+    struct Coefficients {
+        coeff_t a0;
+        coeff_t a1;
+        coeff_t a2;
+
+        constexpr Coefficients(const PIDGains &g, float dt)
+            : a0(arith_t::coeff((double)g.kp + (double)g.ki * dt + (double)g.kd / dt)),
+              a1(arith_t::coeff(-(double)g.kp - 2.0 * g.kd / dt)),
+              a2(arith_t::coeff((double)g.kd / dt)) {}
+    };
+
+    constexpr explicit PIDEngine(const Coefficients &c)
+        : c_(c), e1_(), e2_(), y_() {}
+
+    T calculate(T setpoint, T measured_value)
+    {
+        T error = setpoint - measured_value;
+
+        acc_t acc = y_;
+        acc = arith_t::mac(acc, c_.a0, error);
+        acc = arith_t::mac(acc, c_.a1, e1_);
+        acc = arith_t::mac(acc, c_.a2, e2_);
+        y_ = arith_t::clamp(acc);
+
+        e2_ = e1_;
+        e1_ = error;
+
+        return arith_t::narrow(y_);
+    }
+
+    void reset()
+    {
+        e1_ = T();
+        e2_ = T();
+        y_ = acc_t();
+    }
+
+private:
+    Coefficients c_;
+    T e1_;      // e[n-1]
+    T e2_;      // e[n-2]
+    acc_t y_;   // y[n-1], at the accumulator resolution
+};
+
+#endif // PID_ENGINE_H
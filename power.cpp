@@ -0,0 +1,38 @@
+#include "power.h"
+
+PowerMonitor::PowerMonitor(uint32_t awakeBudgetPermille)
+    : budgetPermille_(awakeBudgetPermille), last_(), window_(), total_() {
+}
+
+bool PowerMonitor::update()
+{
+    mbed_stats_cpu_t now;
+    mbed_stats_cpu_t boot = {};
+
+    mbed_stats_cpu_get(&now);
+    if (now.uptime <= last_.uptime) {
+        return false;
+    }
+
+    window_ = shares(last_, now);
+    total_ = shares(boot, now);
+    last_ = now;
+
+    return true;
+}
+
+power_window_t PowerMonitor::shares(const mbed_stats_cpu_t &from, const mbed_stats_cpu_t &to)
+{
+    power_window_t shares = {};
+    us_timestamp_t uptime = to.uptime - from.uptime;
+
+    if (uptime == 0) {
+        return shares;
+    }
+
+    shares.sleep = (uint32_t)((to.sleep_time - from.sleep_time) * 1000 / uptime);
+    shares.deepSleep = (uint32_t)((to.deep_sleep_time - from.deep_sleep_time) * 1000 / uptime);
+    shares.awake = 1000 - (uint32_t)((to.idle_time - from.idle_time) * 1000 / uptime);
+
+    return shares;
+}
@@ -0,0 +1,41 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "mbed.h"
+
+/* Shares of a time window in tenths of a percent (platform.cpu-stats-enabled) */
+typedef struct
+{
+    uint32_t awake;             // threads or interrupts running
+    uint32_t sleep;             // idle, clocks running
+    uint32_t deepSleep;         // idle, only the low power ticker running
+} power_window_t;
+
+/*
+ *  Duty cycle of the CPU from the Mbed CPU statistics.
+ *
+ *  update() closes a window at every call: the awake share of the window
+ *  is what a battery budget is checked against, the share since boot is
+ *  kept as well. Called by one thread (the main loop report).
+ */
+class PowerMonitor {
+public:
+    explicit PowerMonitor(uint32_t awakeBudgetPermille);
+
+    bool update();              // false when no time elapsed since the previous call
+
+    const power_window_t &window() const { return window_; }     // between the last two update()
+    const power_window_t &total() const { return total_; }       // since boot
+    bool overBudget() const { return window_.awake > budgetPermille_; }
+    uint32_t budgetPermille() const { return budgetPermille_; }
+
+private:
+    static power_window_t shares(const mbed_stats_cpu_t &from, const mbed_stats_cpu_t &to);
+
+    uint32_t budgetPermille_;
+    mbed_stats_cpu_t last_;
+    power_window_t window_;
+    power_window_t total_;
+};
+
+#endif // POWER_H
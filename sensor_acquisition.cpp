@@ -0,0 +1,170 @@
+#include "sensor_acquisition.h"
+
+void SensorFilter::add(uint16_t raw)
+{
+    uint16_t window[SENSOR_MEDIAN];
+    int n;
+
+    /* Ring buffer and running sum: the oldest sample leaves the window */
+    if (count_ == SENSOR_WINDOW) {
+        sum_ -= ring_[next_];
+    } else {
+        count_++;
+    }
+    ring_[next_] = raw;
+    sum_ += raw;
+    next_ = (next_ + 1) & (SENSOR_WINDOW - 1);
+
+    /* Median of the last SENSOR_MEDIAN samples (insertion sort of a copy) */
+    n = count_ < SENSOR_MEDIAN ? count_ : SENSOR_MEDIAN;
+    for (int i = 0; i < n; i++) {
+        uint16_t x = ring_[(next_ - 1 - i) & (SENSOR_WINDOW - 1)];
+        int j = i;
+        while (j > 0 && window[j - 1] > x) {
+            window[j] = window[j - 1];
+            j--;
+        }
+        window[j] = x;
+    }
+    int32_t median = (int32_t)window[n / 2] << SENSOR_EMA_FRAC_BITS;
+
+    if (count_ == 1) {
+        ema_ = median;                              // EMA starts from the first sample
+    } else {
+        ema_ += ((median - ema_) * EMA_WEIGHT + (1 << (SENSOR_EMA_WEIGHT_BITS - 1))) >> SENSOR_EMA_WEIGHT_BITS;
+    }
+}
+
+SensorAcquisition::SensorAcquisition(int rateHz, osPriority priority)
+    : thread_(priority, OS_STACK_SIZE, nullptr, "sensors"), period_(rateHz), channels_(), channelCount_(0),
+      snapshot_(), sequence_(0), notifyFlags_(nullptr), notifyFlag_(0), notifyDivider_(1),
+      conversions_(0), latency_(nullptr), recorder_(nullptr) {
+}
+
+int SensorAcquisition::addChannel(AnalogIn *input, const CalibrationTable &calibration, int divider)
+{
+    if (channelCount_ >= SENSOR_CHANNELS_MAX || divider < 1) {
+        return -1;
+    }
+
+    channels_[channelCount_].input = input;
+    channels_[channelCount_].calibration = &calibration;
+    channels_[channelCount_].divider = divider;
+    return channelCount_++;
+}
+
+void SensorAcquisition::start()
+{
+    /* First sample before the consumers start, so no one reads an empty channel */
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    uint16_t raw[SENSOR_CHANNELS_MAX];
+    for (int i = 0; i < channelCount_; i++) {
+        raw[i] = channels_[i].input->read_u16();
+        sample(channels_[i], raw[i], now);
+    }
+    conversions_ += channelCount_;
+    publish(now, (uint8_t)((1 << channelCount_) - 1), raw);
+
+    thread_.start(callback(this, &SensorAcquisition::run));
+}
+
+sensor_reading_t SensorAcquisition::read(int channel)
+{
+    mutex_.lock();
+    sensor_reading_t reading = channels_[channel].reading;
+    mutex_.unlock();
+
+    return reading;
+}
+
+void SensorAcquisition::notify(EventFlags *flags, uint32_t flag, int divider)
+{
+    notifyFlag_ = flag;
+    notifyDivider_ = divider < 1 ? 1 : divider;
+    notifyFlags_ = flags;
+}
+
+sensor_snapshot_t SensorAcquisition::snapshot()
+{
+    return snapshot_.read();
+}
+
+bool SensorAcquisition::update(sensor_snapshot_t &snapshot)
+{
+    sensor_snapshot_t latest = snapshot_.read();
+
+    if (latest.sequence == snapshot.sequence) {
+        return false;
+    }
+
+    snapshot = latest;
+    return true;
+}
+
+void SensorAcquisition::publish(Kernel::Clock::time_point now, uint8_t mask, const uint16_t *raw)
+{
+    sensor_snapshot_t snapshot;
+
+    for (int i = 0; i < SENSOR_CHANNELS_MAX; i++) {
+        snapshot.value[i] = i < channelCount_ ? channels_[i].reading.value : 0;
+    }
+    snapshot.timestamp = now;
+    snapshot.sequence = ++sequence_;
+
+    snapshot_.write(snapshot);
+
+    if (recorder_ != nullptr) {
+        recorder_->samples(snapshot.sequence, (uint32_t)now.time_since_epoch().count(), mask, raw);
+    }
+
+    if (notifyFlags_ != nullptr && sequence_ % notifyDivider_ == 0) {
+        notifyFlags_->set(notifyFlag_);
+    }
+}
+
+void SensorAcquisition::sample(Channel &channel, uint16_t raw, Kernel::Clock::time_point now)
+{
+    channel.filter.add(raw);
+    uint16_t filtered = channel.filter.value();
+    sensor_value_t value = channel.calibration->convert(filtered);
+
+    mutex_.lock();
+    channel.reading.value = value;
+    channel.reading.filtered = filtered;
+    channel.reading.mean = channel.filter.mean();
+    channel.reading.raw = raw;
+    channel.reading.timestamp = now;
+    mutex_.unlock();
+}
+
+void SensorAcquisition::run()
+{
+    uint16_t raw[SENSOR_CHANNELS_MAX];
+
+    period_.start();
+    while (true) {
+        period_.waitNextPeriod();
+        LatencyProbe probe(latency_);
+        uint32_t tick = period_.ticks();
+
+        uint8_t mask = 0;
+
+        /* All the conversions first, so the channels share the same instant */
+        for (int i = 0; i < channelCount_; i++) {
+            if (tick % channels_[i].divider == 0) {
+                raw[i] = channels_[i].input->read_u16();
+                mask |= (uint8_t)(1 << i);
+                conversions_++;
+            }
+        }
+
+        Kernel::Clock::time_point now = Kernel::Clock::now();
+        for (int i = 0; i < channelCount_; i++) {
+            if (mask & (1 << i)) {
+                sample(channels_[i], raw[i], now);
+            }
+        }
+
+        publish(now, mask, raw);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef SENSOR_ACQUISITION_H
+#define SENSOR_ACQUISITION_H
+
+#include "mbed.h"
+#include "periodic_task.h"
+#include "seqlock.h"
+#include "latency.h"
+#include "calibration.h"
+#include "trace.h"
+
+#define SENSOR_CHANNELS_MAX     8
+#define SENSOR_WINDOW           16      // samples of the running mean (power of two)
+#define SENSOR_MEDIAN           5       // samples of the median filter (odd, <= SENSOR_WINDOW)
+#define SENSOR_EMA_ALPHA        0.2     // weight of the new sample in the EMA
+#define SENSOR_EMA_FRAC_BITS    4       // fraction bits of the EMA state (counts x 16)
+#define SENSOR_EMA_WEIGHT_BITS  12      // fraction bits of the EMA weight
+
+typedef struct
+{
+    sensor_value_t value;               // filtered and calibrated
+    uint16_t filtered;                  // filtered counts: median of the last samples, then EMA
+    uint16_t mean;                      // running mean of the window (counts)
+    uint16_t raw;                       // last conversion (read_u16 counts)
+    Kernel::Clock::time_point timestamp;
+} sensor_reading_t;
+
+/*
+ *  Filtered value of every channel at the same acquisition period
+ */
+typedef struct
+{
+    sensor_value_t value[SENSOR_CHANNELS_MAX];
+    Kernel::Clock::time_point timestamp;
+    uint32_t sequence;                  // incremented at every publication
+} sensor_snapshot_t;
+
+/*
+ *  Integer filters of the ADC counts of a channel (read_u16).
+ *
+ *  The last SENSOR_WINDOW samples are kept in a ring buffer. Each sample
+ *  updates, in constant time, the running mean (sum of the window), a
+ *  median of the last SENSOR_MEDIAN samples (spike rejection) and an EMA of
+ *  the median, kept with SENSOR_EMA_FRAC_BITS fraction bits so that small
+ *  steps are not lost to rounding.
+ */
+class SensorFilter {
+public:
+    SensorFilter() : ring_(), next_(0), count_(0), sum_(0), ema_(0) {}
+
+    void add(uint16_t raw);
+
+    uint16_t value() const { return (uint16_t)((ema_ + (1 << (SENSOR_EMA_FRAC_BITS - 1))) >> SENSOR_EMA_FRAC_BITS); }
+    uint16_t mean() const { return count_ > 0 ? (uint16_t)(sum_ / count_) : 0; }
+
+private:
+    static const int32_t EMA_WEIGHT = (int32_t)(SENSOR_EMA_ALPHA * (1 << SENSOR_EMA_WEIGHT_BITS) + 0.5);
+
+    uint16_t ring_[SENSOR_WINDOW];
+    uint32_t next_;                             // index of the oldest sample
+    uint32_t count_;
+    uint32_t sum_;
+    int32_t ema_;                               // counts << SENSOR_EMA_FRAC_BITS
+};
+
+/*
+ *  Fixed-rate acquisition of the analog inputs.
+ *
+ *  A high priority thread converts every channel once per period with
+ *  read_u16, filters the counts (SensorFilter) and converts the filtered
+ *  counts through the calibration table of the channel: the whole path is
+ *  integer, the snapshot holds calibrated values (calibration.h). A channel
+ *  with a divider is converted every divider periods (slow quantities),
+ *  keeping the ADC load low.
+ *
+ *  The acquisition thread is the only owner of the conversions: after each
+ *  period it publishes a snapshot of all the channels through a SeqLock, so
+ *  the state machine and the control loop act on the same values and the
+ *  control loop reads them without taking a lock. With a TraceRecorder the
+ *  counts of every period are recorded after the publication.
+ */
+class SensorAcquisition {
+public:
+    SensorAcquisition(int rateHz, osPriority priority = osPriorityHigh);
+
+    int addChannel(AnalogIn *input, const CalibrationTable &calibration,
+                   int divider = 1);                    // channel index, -1 when full; before start()
+    void start();
+
+    void notify(EventFlags *flags, uint32_t flag, int divider = 1);    // set flag every divider publications
+    void profile(LatencyHistogram *histogram) { latency_ = histogram; } // duration of each period (conversions to publication)
+    void record(TraceRecorder *recorder) { recorder_ = recorder; }      // counts of every period, before start()
+
+    sensor_snapshot_t snapshot();               // latest published snapshot
+    bool update(sensor_snapshot_t &snapshot);   // copies the latest snapshot if newer, false if unchanged
+    sensor_reading_t read(int channel);         // latest values of a channel
+
+    uint32_t samples() const { return period_.ticks(); }
+    uint32_t conversions() const { return conversions_; }
+    const PeriodicTask &period() const { return period_; }
+
+private:
+    struct Channel {
+        AnalogIn *input;
+        const CalibrationTable *calibration;
+        int divider;
+        SensorFilter filter;
+        sensor_reading_t reading;
+    };
+
+    void sample(Channel &channel, uint16_t raw, Kernel::Clock::time_point now);
+    void publish(Kernel::Clock::time_point now, uint8_t mask, const uint16_t *raw);
+    void run();
+
+    Thread thread_;
+    Mutex mutex_;
+    PeriodicTask period_;
+
+    Channel channels_[SENSOR_CHANNELS_MAX];
+    int channelCount_;
+    SeqLock<sensor_snapshot_t> snapshot_;
+    uint32_t sequence_;
+    EventFlags *notifyFlags_;
+    uint32_t notifyFlag_;
+    int notifyDivider_;
+    uint32_t conversions_;
+    LatencyHistogram *latency_;
+    TraceRecorder *recorder_;
+};
+
+static_assert(SENSOR_CHANNELS_MAX <= TRACE_CHANNELS_MAX, "channel mask of the trace");
+
+#endif // SENSOR_ACQUISITION_H
@@ -0,0 +1,96 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/*
+ *  Single-writer snapshot of a plain struct, shared without locks.
+ *
+ *  Two copies are kept (latch form of the seqlock): the writer bumps the
+ *  sequence, updates the copy the readers are not using, bumps it again and
+ *  updates the other one. A reader copies the current copy and retries only
+ *  if the sequence moved meanwhile. On a single core a reader that preempts
+ *  the writer always finds a stable copy, so the higher priority control
+ *  loop never spins on a half-written state.
+ *
+ *  The data is stored as relaxed atomic words, so the concurrent copy is
+ *  well defined. T must be trivially copyable; writes must be serialized by
+ *  the caller (one writer thread).
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() : sequence_(0) {
+        T initial = T();
+        store(0, initial);
+        store(1, initial);
+    }
+
+    explicit SeqLock(const T &initial) : sequence_(0) {
+        store(0, initial);
+        store(1, initial);
+    }
+
+    void write(const T &value) {
+        uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+
+        sequence_.store(sequence + 1, std::memory_order_release);   // readers move to copy 1
+        std::atomic_thread_fence(std::memory_order_release);
+        store(0, value);
+
+        sequence_.store(sequence + 2, std::memory_order_release);   // readers move to copy 0
+        std::atomic_thread_fence(std::memory_order_release);
+        store(1, value);
+    }
+
+    T read() const {
+        T value;
+
+        while (!tryRead(value)) {
+        }
+
+        return value;
+    }
+
+    bool tryRead(T &value) const {          // false if a write overlapped the copy
+        uint32_t sequence = sequence_.load(std::memory_order_acquire);
+
+        load(sequence & 1, value);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return sequence_.load(std::memory_order_relaxed) == sequence;
+    }
+
+    uint32_t sequence() const { return sequence_.load(std::memory_order_acquire); }
+
+private:
+    enum { WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t) };
+
+    void store(int copy, const T &value) {
+        uint32_t words[WORDS] = {};
+
+        memcpy(words, &value, sizeof(T));
+        for (int i = 0; i < WORDS; i++) {
+            data_[copy][i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    void load(int copy, T &value) const {
+        uint32_t words[WORDS];
+
+        for (int i = 0; i < WORDS; i++) {
+            words[i] = data_[copy][i].load(std::memory_order_relaxed);
+        }
+        memcpy(&value, words, sizeof(T));
+    }
+
+    std::atomic<uint32_t> sequence_;
+    std::atomic<uint32_t> data_[2][WORDS];
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,58 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ *  Lock-free ring buffer for one producer thread and one consumer thread.
+ *
+ *  push() never blocks: when the ring is full the element is rejected and
+ *  the caller decides what to count. Head and tail are free-running
+ *  counters, so N must be a power of two and all N slots are usable.
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    bool push(const T &item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tail_.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    std::atomic<uint32_t> head_;    // written by the producer
+    std::atomic<uint32_t> tail_;    // written by the consumer
+    T items_[N];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,93 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ *  Table-driven finite state machine.
+ *
+ *  The table is a constexpr aggregate: one row per state with its entry and
+ *  exit hooks, one row per edge with source, destination, guard and action
+ *  (hooks and actions can be nullptr). step() takes the first edge leaving
+ *  the current state whose guard holds and runs exit, action and entry, so
+ *  the hooks run only on real transitions. Each edge has a counter.
+ *
+ *  The engine allocates nothing and formats nothing; the state enum must
+ *  number the states from 0.
+ */
+template <typename Context>
+struct StateDef {
+    void (*entry)(Context &context);
+    void (*exit)(Context &context);
+};
+
+template <typename State, typename Context>
+struct EdgeDef {
+    State from;
+    State to;
+    bool (*guard)(const Context &context);
+    void (*action)(Context &context);
+};
+
+template <typename State, typename Context, size_t States, size_t Edges>
+struct StateTable {
+    StateDef<Context> states[States];
+    EdgeDef<State, Context> edges[Edges];
+
+    /* Every edge connects two states of the table and has a guard */
+    constexpr bool valid() const {
+        for (size_t i = 0; i < Edges; i++) {
+            if ((size_t)edges[i].from >= States || (size_t)edges[i].to >= States || edges[i].guard == nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template <typename State, typename Context, size_t States, size_t Edges>
+class StateMachine {
+public:
+    typedef StateTable<State, Context, States, Edges> Table;
+
+    StateMachine(const Table &table, State initial) : table_(table), state_(initial), counters_() {}
+
+    /* Evaluates the edges of the current state; returns true on a transition */
+    bool step(Context &context) {
+        for (size_t i = 0; i < Edges; i++) {
+            const EdgeDef<State, Context> &edge = table_.edges[i];
+
+            if (edge.from != state_ || !edge.guard(context)) {
+                continue;
+            }
+
+            if (table_.states[edge.from].exit != nullptr) {
+                table_.states[edge.from].exit(context);
+            }
+            if (edge.action != nullptr) {
+                edge.action(context);
+            }
+            state_ = edge.to;
+            if (table_.states[edge.to].entry != nullptr) {
+                table_.states[edge.to].entry(context);
+            }
+
+            counters_[i]++;
+            return true;
+        }
+
+        return false;
+    }
+
+    State state() const { return state_; }
+    uint32_t edgeCount(size_t edge) const { return edge < Edges ? counters_[edge] : 0; }
+    static constexpr size_t edges() { return Edges; }
+
+private:
+    const Table &table_;
+    State state_;
+    uint32_t counters_[Edges];
+};
+
+#endif // STATE_MACHINE_H
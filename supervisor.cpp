@@ -0,0 +1,66 @@
+#include "supervisor.h"
+#include "greenhouse.h"
+
+Supervisor::Supervisor(const supervisor_hooks_t &hooks)
+    : hooks_(hooks), dayNight_(E_DAY), lighting_(LIGHTING_TABLE, E_START), control_(),
+      externalLight_(0), internalLight_(0), umidity_(0), timerRunning_(false) {
+}
+
+void Supervisor::step(uint32_t events, const sensor_snapshot_t &snapshot)
+{
+    dayNight_ = getCurrentDayNightState(dayNight_, externalLight_);
+    if (dayNight_ == E_DAY)
+    {
+        control_.lightReference = DAYLIGHT_REFERENCE;
+        control_.umidityReference = UMIDITY_REFERENCE;
+    }
+    else if (dayNight_ == E_NIGHT)
+    {
+        control_.lightReference = snapshot.value[E_SENSOR_USER_LIGHT];
+        control_.umidityReference = snapshot.value[E_SENSOR_USER_UMIDITY];
+    }
+
+    /* Updated every 5 minutes */
+    if (events & EVENT_SENSOR_READ)
+    {
+        externalLight_ = snapshot.value[E_SENSOR_EXTERNAL_LIGHT];
+        internalLight_ = snapshot.value[E_SENSOR_INTERNAL_LIGHT];
+        umidity_ = snapshot.value[E_SENSOR_UMIDITY];
+    }
+
+    /* State machine for controlling brightness */
+    lighting_context_t lightingContext = { dayNight_, internalLight_, &control_, hooks_.print };
+    lighting_.step(lightingContext);
+
+    /* State machine for controlling umidity */
+    switch (dayNight_)
+    {
+        case E_DAY:
+            // Gestire umidita per 1 minuto  (TIMER)
+            if (events & EVENT_UMIDITY_TIME)
+            {
+                timerRunning_ = false;
+            }
+
+            if (umidity_ < MIN_UMIDITY && !timerRunning_)
+            {
+                hooks_.startUmidityTimer();
+                timerRunning_ = true;
+            }
+
+            control_.pid3Running = timerRunning_;
+
+            break;
+
+        case E_NIGHT:
+            hooks_.stopUmidityTimer();
+            timerRunning_ = false;
+
+            control_.pid3Running = true;
+
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include "lighting.h"
+#include "sensor_acquisition.h"
+#include "control_state.h"
+
+#define MAX_UMIDITY    SENSOR_LEVEL(1.0)
+#define MIN_UMIDITY    SENSOR_LEVEL(0.4)
+
+#define UMIDITY_REFERENCE   SENSOR_LEVEL(0.6)
+
+/* Events waking the main loop */
+#define EVENT_SENSOR_READ   (1UL << 0)      // sensorsTicker, once a minute
+#define EVENT_UMIDITY_TIME  (1UL << 1)      // umidityTimeout, humidity window over
+#define EVENT_SNAPSHOT      (1UL << 2)      // new sensor snapshot (slow channels rate)
+#define EVENT_LATENCY_DUMP  (1UL << 3)      // userButton, print the latency histograms
+#define EVENT_ALL           (EVENT_SENSOR_READ | EVENT_UMIDITY_TIME | EVENT_SNAPSHOT | EVENT_LATENCY_DUMP)
+
+/* Side effects of a step, bound to the display and the humidity Timeout by main.cpp */
+typedef struct
+{
+    void (*print)(unsigned char *str);      // lighting state name on the display
+    void (*startUmidityTimer)(void);        // EVENT_UMIDITY_TIME when the humidity window is over
+    void (*stopUmidityTimer)(void);
+} supervisor_hooks_t;
+
+/*
+ *  Decisions of the main loop: day/night hysteresis, references, lighting
+ *  state machine and humidity window, from the events that woke the loop
+ *  and the sensor snapshot it read.
+ *
+ *  A step depends only on its arguments and the previous steps (timers act
+ *  through the hooks and come back as events), so the host replayer drives
+ *  the same code from a recorded trace.
+ */
+class Supervisor {
+public:
+    explicit Supervisor(const supervisor_hooks_t &hooks);
+
+    void step(uint32_t events, const sensor_snapshot_t &snapshot);
+
+    const ControlState &control() const { return control_; }     // publish after each step
+    E_DAY_NIGHT_STATE dayNight() const { return dayNight_; }
+    const LightingMachine &lighting() const { return lighting_; }
+
+private:
+    supervisor_hooks_t hooks_;
+    E_DAY_NIGHT_STATE dayNight_;
+    LightingMachine lighting_;
+    ControlState control_;
+
+    light_t externalLight_;             // latched once a minute (EVENT_SENSOR_READ)
+    light_t internalLight_;
+    umidity_t umidity_;
+    bool timerRunning_;                 // humidity window open
+};
+
+#endif // SUPERVISOR_H
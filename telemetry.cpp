@@ -0,0 +1,87 @@
+#include "telemetry.h"
+
+static uint16_t unitToU16(float value)
+{
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return 0xFFFF;
+    }
+    return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+uint8_t telemetry_checksum(const telemetry_record_t &record)
+{
+    const uint8_t *bytes = (const uint8_t *)&record;
+    uint8_t sum = 0;
+
+    for (size_t i = 0; i < sizeof(record); i++) {
+        sum += bytes[i];
+    }
+
+    return sum;
+}
+
+Telemetry::Telemetry(BufferedSerial &serial, osPriority priority)
+    : serial_(serial), thread_(priority, OS_STACK_SIZE, nullptr, "telemetry"),
+      sequence_(0), logged_(0), dropped_(0), sent_(0) {
+}
+
+void Telemetry::start()
+{
+    thread_.start(callback(this, &Telemetry::run));
+}
+
+bool Telemetry::log(const telemetry_sample_t &sample)
+{
+    telemetry_record_t record;
+
+    record.sync = TELEMETRY_SYNC;
+    record.sequence = sequence_++;
+    record.timestampMs = (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+    record.state = sample.state;
+    record.dayNight = sample.dayNight;
+    record.externalLight = unitToU16(sample.externalLight);
+    record.internalLight = unitToU16(sample.internalLight);
+    record.umidity = unitToU16(sample.umidity);
+    record.lightReference = unitToU16(sample.lightReference);
+    record.umidityReference = unitToU16(sample.umidityReference);
+    record.artificialLight = unitToU16(sample.artificialLight);
+    record.electrochromicGlass = unitToU16(sample.electrochromicGlass);
+    record.nebulizer = unitToU16(sample.nebulizer);
+    record.reserved = 0;
+    record.checksum = 0;
+    record.checksum = (uint8_t)(0 - telemetry_checksum(record));
+
+    if (!ring_.push(record)) {
+        dropped_++;
+        return false;
+    }
+
+    logged_++;
+    return true;
+}
+
+void Telemetry::run()
+{
+    telemetry_record_t batch[TELEMETRY_BATCH];
+
+    while (true) {
+        int count = 0;
+
+        while (count < TELEMETRY_BATCH && ring_.pop(batch[count])) {
+            count++;
+        }
+
+        if (count == 0) {
+            Kernel::Clock::duration now = Kernel::Clock::now().time_since_epoch();
+            Kernel::Clock::duration drain = chrono::milliseconds(TELEMETRY_DRAIN_MS);
+            ThisThread::sleep_until(Kernel::Clock::time_point(now - now % drain + drain));    // with the control burst
+            continue;
+        }
+
+        serial_.write(batch, count * sizeof(telemetry_record_t));
+        sent_ += count;
+    }
+}
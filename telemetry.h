@@ -0,0 +1,87 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "mbed.h"
+#include "spsc_ring.h"
+
+#define TELEMETRY_RING_SIZE     64          // records (power of two)
+#define TELEMETRY_BATCH         8           // records per serial write
+#define TELEMETRY_DRAIN_MS      100         // drain period
+#define TELEMETRY_SYNC          0xA55A
+
+/*
+ *  Fixed-size binary record, little endian, 28 bytes on the wire.
+ *  Values in 0..1 are scaled to 0..65535. The checksum makes the byte sum
+ *  of the record zero, so a decoder can resynchronize on TELEMETRY_SYNC.
+ */
+typedef struct
+{
+    uint16_t sync;
+    uint16_t sequence;                  // counts every record, dropped ones included
+    uint32_t timestampMs;
+    uint8_t state;                      // E_STATE
+    uint8_t dayNight;                   // E_DAY_NIGHT_STATE
+    uint16_t externalLight;
+    uint16_t internalLight;
+    uint16_t umidity;
+    uint16_t lightReference;
+    uint16_t umidityReference;
+    uint16_t artificialLight;           // PWM duties
+    uint16_t electrochromicGlass;
+    uint16_t nebulizer;
+    uint8_t reserved;
+    uint8_t checksum;
+} telemetry_record_t;
+
+static_assert(sizeof(telemetry_record_t) == 28, "telemetry record layout");
+
+typedef struct
+{
+    uint8_t state;
+    uint8_t dayNight;
+    float externalLight;
+    float internalLight;
+    float umidity;
+    float lightReference;
+    float umidityReference;
+    float artificialLight;
+    float electrochromicGlass;
+    float nebulizer;
+} telemetry_sample_t;
+
+uint8_t telemetry_checksum(const telemetry_record_t &record);  // zero for a valid record
+
+/*
+ *  Binary telemetry instead of printf in the control loop.
+ *
+ *  The producer (one thread) encodes a sample into a record and pushes it
+ *  into a lock-free SPSC ring: it never blocks, and when the ring is full
+ *  the record is dropped and counted. A low-priority thread drains the
+ *  ring to the serial port in batches.
+ */
+class Telemetry {
+public:
+    Telemetry(BufferedSerial &serial, osPriority priority = osPriorityLow);
+
+    void start();
+    bool log(const telemetry_sample_t &sample);     // producer side, never blocks
+
+    uint32_t logged() const { return logged_; }
+    uint32_t dropped() const { return dropped_; }
+    uint32_t sent() const { return sent_; }
+    size_t depth() const { return ring_.size(); }
+
+private:
+    void run();
+
+    BufferedSerial &serial_;
+    Thread thread_;
+    SpscRing<telemetry_record_t, TELEMETRY_RING_SIZE> ring_;
+
+    uint16_t sequence_;
+    uint32_t logged_;
+    uint32_t dropped_;
+    uint32_t sent_;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,165 @@
+#include "trace.h"
+
+#include <string.h>
+
+#define TRACE_HEADER    3               // sync, type, length
+#define TRACE_SAMPLES_HEADER    8       // sequence, timestamp
+
+uint8_t trace_checksum(const uint8_t *record, size_t length)
+{
+    uint8_t sum = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        sum += record[i];
+    }
+
+    return sum;
+}
+
+TraceRecorder::TraceRecorder(BufferedSerial &serial, osPriority priority)
+    : serial_(serial), thread_(priority, OS_STACK_SIZE, nullptr, "trace"), rateHz_(0), channels_(0),
+      block_(), periods_(0), nextSequence_(0), seen_(0), last_(), dropped_(0), sent_(0) {
+}
+
+void TraceRecorder::start(int rateHz, int channels)
+{
+    rateHz_ = rateHz;
+    channels_ = channels;
+    thread_.start(callback(this, &TraceRecorder::run));
+}
+
+void TraceRecorder::samples(uint32_t sequence, uint32_t timestampMs, uint8_t mask, const uint16_t *raw)
+{
+    /* Worst case of this period: mask and a 3 byte varint per channel */
+    if (periods_ > 0 && (sequence != nextSequence_ || periods_ == TRACE_BLOCK_PERIODS ||
+                         block_.length + 1 + 3 * TRACE_CHANNELS_MAX > TRACE_HEADER + TRACE_PAYLOAD_MAX)) {
+        flushBlock();
+    }
+
+    if (periods_ == 0) {
+        block_.length = TRACE_HEADER;
+        put32(sequence);
+        put32(timestampMs);
+        seen_ = 0;
+    }
+
+    put(mask);
+    for (int i = 0; i < TRACE_CHANNELS_MAX; i++) {
+        if ((mask & (1 << i)) == 0) {
+            continue;
+        }
+
+        if (seen_ & (1 << i)) {
+            int32_t delta = (int32_t)raw[i] - last_[i];
+            putVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));     // zigzag
+        } else {
+            putVarint(raw[i]);
+            seen_ |= (uint8_t)(1 << i);
+        }
+        last_[i] = raw[i];
+    }
+
+    periods_++;
+    nextSequence_ = sequence + 1;
+
+    if (periods_ == TRACE_BLOCK_PERIODS) {
+        flushBlock();
+    }
+}
+
+void TraceRecorder::step(uint32_t sequence, uint32_t timestampMs, uint32_t events)
+{
+    trace_step_t step = { sequence, timestampMs, (uint8_t)events };
+
+    if (!steps_.push(step)) {
+        dropped_++;
+    }
+}
+
+void TraceRecorder::flushBlock()
+{
+    block_.bytes[0] = TRACE_SYNC;
+    block_.bytes[1] = E_TRACE_SAMPLES;
+    block_.bytes[2] = (uint8_t)(block_.length - TRACE_HEADER);
+    block_.bytes[block_.length] = 0;
+    block_.bytes[block_.length] = (uint8_t)(0 - trace_checksum(block_.bytes, block_.length));
+    block_.length++;
+
+    if (!blocks_.push(block_)) {
+        dropped_++;
+    }
+    periods_ = 0;
+}
+
+void TraceRecorder::put(uint8_t value)
+{
+    block_.bytes[block_.length++] = value;
+}
+
+void TraceRecorder::putVarint(uint32_t value)
+{
+    while (value >= 0x80) {
+        put((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    put((uint8_t)value);
+}
+
+void TraceRecorder::put32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        put((uint8_t)(value >> (8 * i)));
+    }
+}
+
+/* Drain thread only: writes a record built from payload */
+void TraceRecorder::write(uint8_t type, const uint8_t *payload, size_t length)
+{
+    uint8_t record[TRACE_HEADER + 16];
+
+    record[0] = TRACE_SYNC;
+    record[1] = type;
+    record[2] = (uint8_t)length;
+    memcpy(&record[TRACE_HEADER], payload, length);
+    record[TRACE_HEADER + length] = 0;
+    record[TRACE_HEADER + length] = (uint8_t)(0 - trace_checksum(record, TRACE_HEADER + length));
+
+    serial_.write(record, TRACE_HEADER + length + 1);
+    sent_ += TRACE_HEADER + length + 1;
+}
+
+void TraceRecorder::run()
+{
+    uint8_t start[3] = { (uint8_t)rateHz_, (uint8_t)(rateHz_ >> 8), (uint8_t)channels_ };
+    trace_block_t block;
+    trace_step_t step;
+
+    write(E_TRACE_START, start, sizeof(start));
+
+    while (true) {
+        bool idle = true;
+
+        while (blocks_.pop(block)) {
+            serial_.write(block.bytes, block.length);
+            sent_ += block.length;
+            idle = false;
+        }
+
+        while (steps_.pop(step)) {
+            uint8_t payload[9];
+            for (int i = 0; i < 4; i++) {
+                payload[i] = (uint8_t)(step.sequence >> (8 * i));
+                payload[4 + i] = (uint8_t)(step.timestampMs >> (8 * i));
+            }
+            payload[8] = step.events;
+            write(E_TRACE_STEP, payload, sizeof(payload));
+            idle = false;
+        }
+
+        if (idle) {
+            Kernel::Clock::duration now = Kernel::Clock::now().time_since_epoch();
+            Kernel::Clock::duration drain = chrono::milliseconds(TRACE_DRAIN_MS);
+            ThisThread::sleep_until(Kernel::Clock::time_point(now - now % drain + drain));    // with the control burst
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "mbed.h"
+#include "spsc_ring.h"
+
+#define TRACE_SYNC              0x5A
+#define TRACE_CHANNELS_MAX      8           // bits of the channel mask
+#define TRACE_PAYLOAD_MAX       255
+#define TRACE_BLOCK_PERIODS     32          // acquisition periods per samples record at most
+#define TRACE_RING_SIZE         8           // samples records (power of two)
+#define TRACE_STEP_RING_SIZE    32          // main loop steps (power of two)
+#define TRACE_DRAIN_MS          100         // drain period
+
+/*
+ *  Sensor trace on the wire. Every record is
+ *
+ *      sync (TRACE_SYNC), type, payload length, payload, checksum
+ *
+ *  with the checksum making the byte sum of the record zero, so a reader
+ *  resynchronizes after corrupted data. Numbers are little endian.
+ *
+ *  E_TRACE_START       acquisition rate Hz (u16), channels (u8)
+ *  E_TRACE_SAMPLES     sequence of the first period (u32), its timestamp
+ *                      ms (u32), then for each period (consecutive
+ *                      sequences): mask of the converted channels (u8)
+ *                      and their read_u16 counts. A count is a varint
+ *                      (7 bits per byte, low first): the first one of a
+ *                      channel in the record is absolute, the next ones
+ *                      are zigzag deltas from the previous one.
+ *  E_TRACE_STEP        sequence of the snapshot used (u32), timestamp ms
+ *                      (u32), events that woke the main loop (u8)
+ */
+typedef enum
+{
+    E_TRACE_START = 1,
+    E_TRACE_SAMPLES,
+    E_TRACE_STEP
+} E_TRACE_RECORD;
+
+/* A record ready for the wire */
+typedef struct
+{
+    uint16_t length;
+    uint8_t bytes[TRACE_PAYLOAD_MAX + 4];
+} trace_block_t;
+
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t timestampMs;
+    uint8_t events;
+} trace_step_t;
+
+uint8_t trace_checksum(const uint8_t *record, size_t length);  // zero for a valid record
+
+/*
+ *  Recorder of the controller inputs: every conversion of the acquisition
+ *  thread and every main loop wake-up with its events (timers included),
+ *  enough for the host replayer (host/trace_replay.cpp) to run the
+ *  filters, the supervisor and the PID bank again.
+ *
+ *  The two producers (acquisition thread, main loop) each push into their
+ *  own lock-free ring and never block: a full ring drops the record and
+ *  counts it. The samples of consecutive periods are delta-encoded into
+ *  one record, about 5 bytes per period for two fast channels (0.5 kB/s at
+ *  100 Hz). A low-priority thread drains both rings to the serial port.
+ */
+class TraceRecorder {
+public:
+    TraceRecorder(BufferedSerial &serial, osPriority priority = osPriorityLow);
+
+    void start(int rateHz, int channels);
+
+    /* Acquisition thread: counts of the channels in mask, raw[i] for bit i */
+    void samples(uint32_t sequence, uint32_t timestampMs, uint8_t mask, const uint16_t *raw);
+
+    /* Main loop: the step that used snapshot sequence, woken by events */
+    void step(uint32_t sequence, uint32_t timestampMs, uint32_t events);
+
+    uint32_t dropped() const { return dropped_; }       // records lost, ring full
+    uint32_t sent() const { return sent_; }             // bytes written
+
+private:
+    void flushBlock();
+    void put(uint8_t value);
+    void putVarint(uint32_t value);
+    void put32(uint32_t value);
+    void write(uint8_t type, const uint8_t *payload, size_t length);
+    void run();
+
+    BufferedSerial &serial_;
+    Thread thread_;
+    SpscRing<trace_block_t, TRACE_RING_SIZE> blocks_;
+    SpscRing<trace_step_t, TRACE_STEP_RING_SIZE> steps_;
+
+    int rateHz_;
+    int channels_;
+
+    /* Samples record being filled by the acquisition thread */
+    trace_block_t block_;
+    int periods_;
+    uint32_t nextSequence_;
+    uint8_t seen_;                      // channels already in the record
+    uint16_t last_[TRACE_CHANNELS_MAX];
+
+    uint32_t dropped_;
+    uint32_t sent_;
+};
+
+#endif // TRACE_H
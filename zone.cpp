@@ -0,0 +1,118 @@
+#include "zone.h"
+
+ZoneController::ZoneController(float dt, int32_t pwmPeriodUs)
+    : dt_(dt), zones_(), limits_(), suspended_(), releaseIdle_(false), periodUs_(pwmPeriodUs), bootUs_(0), zoneCount_(0) {
+}
+
+void ZoneController::setLimits(E_ZONE_LOOP loop, const actuator_limits_t &limits)
+{
+    limits_[loop] = limits;
+
+    for (int z = 0; z < zoneCount_; z++) {
+        channels_[z][loop].configure(periodUs_, limits, channels_[z][loop].width());
+    }
+}
+
+int ZoneController::addZone(const zone_t &zone, const PIDGains &pullUp, const PIDGains &pullDown,
+                            const PIDGains &umidity)
+{
+    if (zoneCount_ >= ZONES_MAX || !pid_gains_fit(pullUp, dt_) || !pid_gains_fit(pullDown, dt_) ||
+        !pid_gains_fit(umidity, dt_)) {
+        return -1;
+    }
+
+    bank_.add(pullUp.kp, pullUp.ki, pullUp.kd, dt_);
+    bank_.add(pullDown.kp, pullDown.ki, pullDown.kd, dt_);
+    bank_.add(umidity.kp, umidity.ki, umidity.kd, dt_);
+
+    zones_[zoneCount_] = zone;
+    for (int loop = 0; loop < E_ZONE_LOOPS; loop++) {
+        channels_[zoneCount_][loop].configure(periodUs_, limits_[loop], bootUs_);
+    }
+    return zoneCount_++;
+}
+
+void ZoneController::calculate(const sensor_snapshot_t &snapshot, const ControlState &state)
+{
+    for (int z = 0; z < zoneCount_; z++) {
+        const zone_t &zone = zones_[z];
+        int loop = z * E_ZONE_LOOPS;
+        Q15 internalLight = Q15::fromRaw(Q15::saturate(snapshot.value[zone.internalLight]));
+        Q15 umidity = Q15::fromRaw(Q15::saturate(snapshot.value[zone.umidity]));
+        Q15 lightReference = Q15::fromRaw(Q15::saturate(state.lightReference));
+        Q15 umidityReference = Q15::fromRaw(Q15::saturate(state.umidityReference));
+
+        bank_.input(loop + E_ZONE_PULL_UP, lightReference, internalLight, state.pid1Running);
+        bank_.input(loop + E_ZONE_PULL_DOWN, lightReference, internalLight, state.pid2Running);
+        bank_.input(loop + E_ZONE_UMIDITY, umidityReference, umidity, state.pid3Running);
+    }
+
+    bank_.calculate();
+}
+
+void ZoneController::write()
+{
+    for (int z = 0; z < zoneCount_; z++) {
+        const zone_t &zone = zones_[z];
+        PwmOut *actuators[E_ZONE_LOOPS] = { zone.artificialLight, zone.electrochromicGlass, zone.nebulizer };
+
+        for (int loop = 0; loop < E_ZONE_LOOPS; loop++) {
+            ActuatorChannel &channel = channels_[z][loop];
+
+            // Write the PID output to the actuator (0 to period), only when it changes
+            if (!channel.update(pulseWidthUs(z, (E_ZONE_LOOP)loop)) || actuators[loop] == nullptr) {
+                continue;
+            }
+
+            if (suspended_[z][loop]) {
+                actuators[loop]->resume();
+                suspended_[z][loop] = false;
+            }
+            actuators[loop]->pulsewidth_us(channel.width());
+            if (releaseIdle_ && channel.width() == 0) {
+                actuators[loop]->suspend();         // off: the PWM timer may stop in deep sleep
+                suspended_[z][loop] = true;
+            }
+        }
+    }
+}
+
+int ZoneController::pulseWidthUs(int zone, E_ZONE_LOOP loop) const
+{
+    return pulse_width_us(output(zone, loop), periodUs_);
+}
+
+uint32_t ZoneController::writesIssued(E_ZONE_LOOP loop) const
+{
+    uint32_t issued = 0;
+
+    for (int z = 0; z < zoneCount_; z++) {
+        issued += channels_[z][loop].issued();
+    }
+
+    return issued;
+}
+
+uint32_t ZoneController::writesSuppressed(E_ZONE_LOOP loop) const
+{
+    uint32_t suppressed = 0;
+
+    for (int z = 0; z < zoneCount_; z++) {
+        suppressed += channels_[z][loop].suppressed();
+    }
+
+    return suppressed;
+}
+
+int ZoneController::suspended() const
+{
+    int count = 0;
+
+    for (int z = 0; z < zoneCount_; z++) {
+        for (int loop = 0; loop < E_ZONE_LOOPS; loop++) {
+            count += suspended_[z][loop] ? 1 : 0;
+        }
+    }
+
+    return count;
+}
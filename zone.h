@@ -0,0 +1,109 @@
+#ifndef ZONE_H
+#define ZONE_H
+
+#include "mbed.h"
+#include "actuator.h"
+#include "pid_bank.h"
+#include "pid_engine.h"
+#include "sensor_acquisition.h"
+#include "control_state.h"
+
+/* Control loops of a zone, in the order of their bank indices */
+typedef enum
+{
+    E_ZONE_PULL_UP = 0,         // pull up light    -->     artificialLight
+    E_ZONE_PULL_DOWN,           // pull down light  -->     electrochromicGlass
+    E_ZONE_UMIDITY,             // umidity          -->     nebulizer
+    E_ZONE_LOOPS
+} E_ZONE_LOOP;
+
+#define ZONES_MAX   (PID_BANK_SIZE / E_ZONE_LOOPS)
+
+/* Q15 duty as a pulse width of periodUs, rounded and clamped to [0, periodUs] */
+inline int pulse_width_us(Q15 duty, int32_t periodUs)
+{
+    int32_t raw = duty.raw();
+
+    if (raw <= 0) {
+        return 0;
+    }
+
+    /* RAW_MAX (1 - 2^-15) is the whole period */
+    return raw >= Q15::RAW_MAX ? periodUs : (int)((raw * periodUs + (1 << 14)) >> 15);
+}
+
+/*
+ *  Inputs and actuators of a greenhouse zone
+ */
+typedef struct
+{
+    int internalLight;              // channels of the sensor snapshot
+    int umidity;
+    PwmOut *artificialLight;
+    PwmOut *electrochromicGlass;
+    PwmOut *nebulizer;
+} zone_t;                           // null actuators are not written (host replay)
+
+/*
+ *  The greenhouse zones of one controller.
+ *
+ *  The three PID loops of every zone live in a single PIDBankQ15 (zone z
+ *  owns loops 3z..3z+2), so a PID tick is one pass over all the zones
+ *  followed by the PWM writes. The zones share the references and running
+ *  flags of the control state.
+ *
+ *  The tick is integer only: the calibrated sensor values and references
+ *  are Q15, and a Q15 duty becomes a pulse width in microseconds of the
+ *  PWM period (pulsewidth_us). Every actuator runs at the PWM period
+ *  given to the constructor.
+ *
+ *  write() goes through an ActuatorChannel per actuator, with the limits
+ *  of its loop: a pulse width within the deadband of the applied one is
+ *  not written again, and the slew rate bounds the change per tick. The
+ *  channels start from the duty given to bootDuty() (the one written to
+ *  the actuators at boot), so a slewed actuator ramps down from it.
+ *
+ *  With releaseIdle() an actuator driven to 0 is suspended (PwmOut::suspend):
+ *  its timer no longer blocks deep sleep until it is driven again. The
+ *  output pin is released, so the actuator driver must pull it low.
+ */
+class ZoneController {
+public:
+    ZoneController(float dt, int32_t pwmPeriodUs);
+
+    void setLimits(E_ZONE_LOOP loop, const actuator_limits_t &limits);     // every zone, default none
+    void releaseIdle(bool release) { releaseIdle_ = release; }            // before the first write()
+    void bootDuty(float duty) { bootUs_ = (int32_t)(duty * periodUs_ + 0.5f); }  // before addZone(), default 0
+
+    int addZone(const zone_t &zone, const PIDGains &pullUp, const PIDGains &pullDown,
+                const PIDGains &umidity);       // zone index, -1 when full or gains out of range
+
+    void calculate(const sensor_snapshot_t &snapshot, const ControlState &state);  // every PID of every zone
+    void write();                               // outputs of the last calculate() to the actuators
+
+    Q15 output(int zone, E_ZONE_LOOP loop) const { return bank_.output(zone * E_ZONE_LOOPS + loop); }
+    int pulseWidthUs(int zone, E_ZONE_LOOP loop) const;    // output as PWM ticks, clamped to [0, period]
+    int appliedWidthUs(int zone, E_ZONE_LOOP loop) const { return channels_[zone][loop].width(); }
+
+    /* Commanded duty (0..1) of an actuator, also while suspended; one aligned word written by the PID thread */
+    float appliedDuty(int zone, E_ZONE_LOOP loop) const { return (float)appliedWidthUs(zone, loop) / (float)periodUs_; }
+
+    uint32_t writesIssued(E_ZONE_LOOP loop) const;         // all the zones
+    uint32_t writesSuppressed(E_ZONE_LOOP loop) const;
+    int suspended() const;                                  // actuators released by releaseIdle()
+    int zones() const { return zoneCount_; }
+
+private:
+    float dt_;
+    PIDBankQ15 bank_;
+    zone_t zones_[ZONES_MAX];
+    ActuatorChannel channels_[ZONES_MAX][E_ZONE_LOOPS];
+    actuator_limits_t limits_[E_ZONE_LOOPS];
+    bool suspended_[ZONES_MAX][E_ZONE_LOOPS];
+    bool releaseIdle_;
+    int32_t periodUs_;
+    int32_t bootUs_;
+    int zoneCount_;
+};
+
+#endif // ZONE_H